@@ -0,0 +1,85 @@
+#include <afv_hex.hpp>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <string>
+
+namespace
+{
+    // Number of bytes from the beginning of the content checked for text
+    constexpr std::size_t sample_size{1 << 16};
+
+    // Content with more than one control character in this many bytes is
+    // binary
+    constexpr std::size_t binary_control_ratio{32};
+
+    // Whitespace and escape of terminal colors are common in text
+    [[nodiscard]] constexpr bool is_text_control(unsigned char const byte)
+    {
+        return (byte >= '\t' && byte <= '\r') || byte == 0x1B;
+    }
+} // namespace
+
+bool afv::looks_binary(std::span<char const> content)
+{
+    auto const sample{content.first(std::min(content.size(), sample_size))};
+    auto const controls{std::ranges::count_if(sample,
+        [](char const c)
+        {
+            auto const byte{static_cast<unsigned char>(c)};
+            return (byte < 0x20 && !is_text_control(byte)) || byte == 0x7F;
+        })};
+
+    return std::ranges::find(sample, '\0') != sample.end() ||
+        static_cast<std::size_t>(controls) * binary_control_ratio >
+        sample.size();
+}
+
+int afv::offset_digits(std::size_t size)
+{
+    int rv{8};
+    for (size >>= 32; size != 0; size >>= 4)
+    {
+        ++rv;
+    }
+    return rv;
+}
+
+std::string afv::format_hex_row(std::size_t const offset,
+    std::span<char const> const bytes,
+    int const digits)
+{
+    std::string rv;
+    auto out{std::back_inserter(rv)};
+    out = fmt::format_to(out, "{:0{}x} ", offset, digits);
+    for (std::size_t i{}; i != hex_row_bytes; ++i)
+    {
+        if (i % 8 == 0)
+        {
+            rv.push_back(' ');
+        }
+
+        if (i < bytes.size())
+        {
+            out = fmt::format_to(out,
+                "{:02x} ",
+                static_cast<unsigned char>(bytes[i]));
+        }
+        else
+        {
+            rv.append("   ");
+        }
+    }
+
+    rv.append(" |");
+    std::ranges::transform(bytes,
+        out,
+        [](char const c) { return c >= ' ' && c <= '~' ? c : '.'; });
+    rv.push_back('|');
+
+    return rv;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+namespace afv
+{
+    // Number of bytes displayed in a row of the hex view
+    inline constexpr std::size_t hex_row_bytes{16};
+
+    // Content is binary when its beginning contains NUL characters or more
+    // than one in 32 bytes is a control character other than whitespace or
+    // escape. Text in encodings other than UTF-8 isn't
+    // binary. Only the beginning is read so that large files open without
+    // touching all of their pages.
+    [[nodiscard]] bool looks_binary(std::span<char const> content);
+
+    // Number of hexadecimal digits used for offsets into content of the size
+    [[nodiscard]] int offset_digits(std::size_t size);
+
+    // Row of the hex view with the offset, hexadecimal values and printable
+    // ASCII characters of up to hex_row_bytes bytes
+    [[nodiscard]] std::string format_hex_row(std::size_t offset,
+        std::span<char const> bytes,
+        int digits);
+} // namespace afv
@@ -0,0 +1,232 @@
+#include <afv_layout.hpp>
+
+#include <afvbuf_text_buffer.hpp>
+#include <afvbuf_trace.hpp>
+#include <afvbuf_unicode.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <vector>
+
+namespace
+{
+    // Layouts are dropped once this many lines were visited
+    constexpr std::size_t max_cached_lines{1 << 16};
+} // namespace
+
+afv::layout_cache::layout_cache(buf::text_buffer const& buffer,
+    std::size_t const width)
+    : buffer_{&buffer}
+    , width_{std::max<std::size_t>(width, 1)}
+{
+}
+
+void afv::layout_cache::set_width(std::size_t const width)
+{
+    if (auto const new_width{std::max<std::size_t>(width, 1)};
+        new_width != width_)
+    {
+        width_ = new_width;
+        lines_.clear();
+    }
+}
+
+std::size_t afv::layout_cache::rows(std::size_t const line)
+{
+    return layout(line).rows;
+}
+
+std::size_t afv::layout_cache::first_column(visual_row const row)
+{
+    auto const& line{layout(row.line)};
+    if (row.row >= line.rows)
+    {
+        return line.columns;
+    }
+
+    auto const it{
+        std::ranges::upper_bound(line.starts, row.row, {}, &row_start::row)};
+    if (it == line.starts.cbegin())
+    {
+        return row.row * width_;
+    }
+
+    auto const& start{*std::prev(it)};
+    return start.column + (row.row - start.row) * width_;
+}
+
+afv::visual_row afv::layout_cache::row_at(std::size_t const line,
+    std::size_t const column)
+{
+    auto const& layout_of_line{layout(line)};
+    auto const& starts{layout_of_line.starts};
+    auto const it{
+        std::ranges::upper_bound(starts, column, {}, &row_start::column)};
+    auto const start{it == starts.cbegin() ? row_start{} : *std::prev(it)};
+    auto const next{it == starts.cend() ? layout_of_line.rows : it->row};
+    return {.line = line,
+        .row = std::min(start.row + (column - start.column) / width_,
+            next - 1)};
+}
+
+afv::visual_row afv::layout_cache::last_row()
+{
+    auto const lines{buffer_->lines()};
+    auto const line{lines == 0 ? 0 : lines - 1};
+    return {.line = line, .row = rows(line) - 1};
+}
+
+afv::visual_row afv::layout_cache::advance(visual_row row,
+    std::ptrdiff_t const count)
+{
+    AFV_TRACE_SCOPE("layout");
+    auto const last{last_row()};
+    if (count > 0)
+    {
+        auto remaining{static_cast<std::size_t>(count)};
+        while (row.line != last.line)
+        {
+            auto const rows_after{rows(row.line) - row.row - 1};
+            if (remaining <= rows_after)
+            {
+                row.row += remaining;
+                return row;
+            }
+
+            remaining -= rows_after + 1;
+            ++row.line;
+            row.row = 0;
+        }
+
+        row.row = std::min(row.row + remaining, last.row);
+    }
+    else if (count < 0)
+    {
+        auto remaining{static_cast<std::size_t>(-count)};
+        while (remaining > row.row && row.line != 0)
+        {
+            remaining -= row.row + 1;
+            --row.line;
+            row.row = rows(row.line) - 1;
+        }
+
+        row.row -= std::min(remaining, row.row);
+    }
+
+    return row;
+}
+
+void afv::layout_cache::invalidate(std::size_t const line,
+    std::size_t const removed,
+    std::size_t const added)
+{
+    // Layouts of the edited lines are dropped, layouts of the following
+    // lines are kept and only renumbered in place
+    auto const first{
+        std::ranges::lower_bound(lines_, line, {}, &line_layout::line)};
+    auto const last{std::ranges::lower_bound(first,
+        lines_.end(),
+        line + removed,
+        {},
+        &line_layout::line)};
+    for (auto& following :
+        std::ranges::subrange(lines_.erase(first, last), lines_.end()))
+    {
+        following.line = following.line - removed + added;
+    }
+}
+
+afv::layout_cache::line_layout const& afv::layout_cache::layout(
+    std::size_t const line)
+{
+    auto it{std::ranges::lower_bound(lines_, line, {}, &line_layout::line)};
+    if (it != lines_.cend() && it->line == line)
+    {
+        return *it;
+    }
+
+    if (lines_.size() == max_cached_lines)
+    {
+        lines_.clear();
+        it = lines_.end();
+    }
+
+    return *lines_.insert(it, calculate(line));
+}
+
+afv::layout_cache::line_layout afv::layout_cache::calculate(
+    std::size_t const line) const
+{
+    AFV_TRACE_SCOPE("layout::calculate");
+    auto const first{buffer_->line_offset(line)};
+    line_layout rv{.line = line, .columns = buffer_->line_width(line)};
+    auto const last{buffer_->column_offset(line, rv.columns)};
+
+    // Every character is a single code unit one column wide
+    if (rv.columns <= width_ ||
+        (buffer_->position(last).code_point == last - first &&
+            rv.columns == last - first))
+    {
+        rv.rows = rv.columns == 0 ? 1 : (rv.columns + width_ - 1) / width_;
+        return rv;
+    }
+
+    // First column of the current row and column of the next character
+    std::size_t row{};
+    std::size_t column{};
+    std::size_t current{};
+    auto const place = [&](std::size_t const columns)
+    {
+        // Wide character crossing the end of the row starts the next row, a
+        // row narrower than the character contains only it
+        if (current + columns > column + width_ && current > column)
+        {
+            if (current != column + width_)
+            {
+                rv.starts.push_back({.row = row + 1, .column = current});
+            }
+            ++row;
+            column = current;
+        }
+        current += columns;
+    };
+
+    // Pieces of the line hold whole sequences, the same as the column index
+    // of the buffer assumes
+    buffer_->for_each_span(first,
+        last - first,
+        [&](std::span<char const> const span)
+        {
+            for (auto rest{span}; !rest.empty();)
+            {
+                // Rows of ASCII characters are placed together
+                auto const ascii{static_cast<std::size_t>(std::distance(
+                    rest.begin(),
+                    std::ranges::find_if(rest,
+                        [](char const unit)
+                        { return buf::detail::code_unit(unit) >= 0x80U; })))};
+                for (auto remaining{ascii}; remaining != 0;)
+                {
+                    place(1);
+                    auto const count{
+                        std::min(remaining - 1, column + width_ - current)};
+                    current += count;
+                    remaining -= count + 1;
+                }
+                rest = rest.subspan(ascii);
+
+                if (!rest.empty())
+                {
+                    auto const decoded{buf::decode(rest)};
+                    place(buf::display_width(decoded.value));
+                    rest = rest.subspan(decoded.length);
+                }
+            }
+        });
+
+    rv.rows = row + 1;
+    return rv;
+}
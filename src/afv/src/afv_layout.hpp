@@ -0,0 +1,98 @@
+#pragma once
+
+#include <afvbuf_text_buffer.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace afv
+{
+    // Row of a soft wrapped logical line
+    struct visual_row final
+    {
+        std::size_t line{};
+        std::size_t row{};
+
+        friend constexpr bool operator==(visual_row const&,
+            visual_row const&) noexcept = default;
+    };
+
+    // Maps logical lines of a buffer to visual rows of a fixed width. Rows
+    // end at character boundaries, a wide character which doesn't fit at the
+    // end of a row starts the next one. Layout of a line is calculated on
+    // demand and cached only for lines which were visited. Lines of ASCII
+    // text are laid out from their width alone, other lines are decoded once
+    // when they are first visited.
+    class [[nodiscard]] layout_cache final
+    {
+    public: // Construction
+        layout_cache(buf::text_buffer const& buffer, std::size_t width);
+
+        layout_cache(layout_cache const&) = default;
+
+        layout_cache(layout_cache&&) noexcept = default;
+
+    public: // Destruction
+        ~layout_cache() = default;
+
+    public: // Interface
+        [[nodiscard]] std::size_t width() const noexcept { return width_; }
+
+        void set_width(std::size_t width);
+
+        [[nodiscard]] std::size_t rows(std::size_t line);
+
+        // Display column of the line where the row starts, for the row one
+        // past the last row of the line the width of the line
+        [[nodiscard]] std::size_t first_column(visual_row row);
+
+        // Row which displays the column of the line
+        [[nodiscard]] visual_row row_at(std::size_t line, std::size_t column);
+
+        [[nodiscard]] visual_row last_row();
+
+        // Moves the row by count rows, stops at the first and last row of the
+        // buffer
+        [[nodiscard]] visual_row advance(visual_row row, std::ptrdiff_t count);
+
+        // Lines [line, line + removed) of the buffer were replaced by added
+        // lines, has to be called for every edit of the buffer
+        void invalidate(std::size_t line,
+            std::size_t removed,
+            std::size_t added);
+
+    public: // Operators
+        layout_cache& operator=(layout_cache const&) = default;
+
+        layout_cache& operator=(layout_cache&&) noexcept = default;
+
+    private: // Types
+        // Row which doesn't start width columns after the start of the
+        // previous row
+        struct row_start final
+        {
+            std::size_t row{};
+            std::size_t column{};
+        };
+
+        struct line_layout final
+        {
+            std::size_t line{};
+            std::size_t columns{};
+            std::size_t rows{};
+            // Rows between two starts start width columns apart
+            std::vector<row_start> starts{};
+        };
+
+    private: // Helpers
+        [[nodiscard]] line_layout const& layout(std::size_t line);
+
+        [[nodiscard]] line_layout calculate(std::size_t line) const;
+
+    private: // Data
+        buf::text_buffer const* buffer_;
+        std::size_t width_;
+        // Sorted by line
+        std::vector<line_layout> lines_;
+    };
+} // namespace afv
@@ -1,14 +1,784 @@
+#include <afv_hex.hpp>
+#include <afv_layout.hpp>
+#include <afv_loader.hpp>
+
+#include <afvbuf_text_buffer.hpp>
+#include <afvbuf_trace.hpp>
+#include <afvbuf_unicode.hpp>
+
 #include <curses.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <clocale>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Lower bound of the number of threads loading documents
+    constexpr std::size_t min_loader_threads{4};
+
+    // Number of bytes read from a file at once, the first chunk is larger
+    // than the sample checked by looks_binary()
+    constexpr std::size_t chunk_size{1 << 20};
+
+    // Trace file written when AFV_TRACE_FILE isn't set
+    constexpr char const* default_trace_file{"afv-trace.json"};
+
+    // Private writable mapping of a whole file, pages are read on first
+    // access and modifications are never written back. Swap space isn't
+    // reserved for the mapping so that files larger than the memory can be
+    // mapped. Access to pages past the end of a file truncated while it is
+    // mapped raises SIGBUS.
+    class [[nodiscard]] mapped_file final
+    {
+    public: // Construction
+        explicit mapped_file(char const* const path)
+        {
+            int const fd{open(path, O_RDONLY | O_CLOEXEC)};
+            if (fd == -1)
+            {
+                throw std::system_error{errno, std::generic_category()};
+            }
+
+            struct stat st{};
+            if (fstat(fd, &st) == -1)
+            {
+                auto const error{errno};
+                close(fd);
+                throw std::system_error{error, std::generic_category()};
+            }
+
+            auto const size{static_cast<std::size_t>(st.st_size)};
+            if (size != 0)
+            {
+                void* const data{mmap(nullptr,
+                    size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_NORESERVE,
+                    fd,
+                    0)};
+                if (data == MAP_FAILED)
+                {
+                    auto const error{errno};
+                    close(fd);
+                    throw std::system_error{error, std::generic_category()};
+                }
+                content_ = {static_cast<char*>(data), size};
+            }
+            close(fd);
+        }
+
+        mapped_file(mapped_file const&) = delete;
+
+        mapped_file(mapped_file&&) = delete;
+
+    public: // Destruction
+        ~mapped_file()
+        {
+            if (!content_.empty())
+            {
+                munmap(content_.data(), content_.size());
+            }
+        }
+
+    public: // Interface
+        [[nodiscard]] std::span<char> content() const noexcept
+        {
+            return content_;
+        }
+
+    public: // Operators
+        mapped_file& operator=(mapped_file const&) = delete;
+
+        mapped_file& operator=(mapped_file&&) = delete;
+
+    private: // Data
+        std::span<char> content_;
+    };
+
+    // Reads a text file into add buffers of the buffer, returns false
+    // without reading the rest of the file when its beginning looks binary.
+    // Reading stops between chunks when a stop is requested.
+    [[nodiscard]] bool read_text(char const* const path,
+        afv::buf::text_buffer& buffer,
+        std::stop_token const& token)
+    {
+        std::unique_ptr<FILE, decltype(&fclose)> const file{fopen(path, "rb"),
+            &fclose};
+        if (!file)
+        {
+            throw std::system_error{errno, std::generic_category()};
+        }
+
+        std::vector<char> chunk(chunk_size);
+        std::string pending;
+        for (bool first{true}; !token.stop_requested(); first = false)
+        {
+            auto const read{fread(chunk.data(), 1, chunk.size(), file.get())};
+            if (ferror(file.get()))
+            {
+                throw std::runtime_error{"io error"};
+            }
+
+            if (first &&
+                afv::looks_binary(std::span<char const>{chunk}.first(read)))
+            {
+                return false;
+            }
+
+            if (read == 0)
+            {
+                break;
+            }
+
+            // Insert only whole lines, or whole code points of a long line,
+            // so that every add buffer contains complete sequences
+            pending.append(chunk.data(), read);
+            auto cut{pending.rfind('\n')};
+            if (cut != std::string::npos)
+            {
+                ++cut;
+            }
+            else
+            {
+                cut = pending.size() - 1;
+                while (cut != 0 && !afv::buf::is_code_point_start(pending[cut]))
+                {
+                    --cut;
+                }
+            }
+
+            buffer.insert(buffer.size(),
+                pending.cbegin(),
+                std::next(pending.cbegin(),
+                    static_cast<std::string::difference_type>(cut)));
+            pending.erase(0, cut);
+        }
+
+        buffer.insert(buffer.size(), pending);
+        return true;
+    }
+
+    enum class view_mode
+    {
+        text,
+        hex
+    };
+
+    void render_row(afv::buf::text_buffer const& buffer,
+        afv::layout_cache& layout,
+        afv::visual_row const row,
+        int const y)
+    {
+        // Rows start and end at character boundaries
+        auto const content{buffer.line(row.line,
+            layout.first_column(row),
+            layout.first_column({.line = row.line, .row = row.row + 1}))};
+        std::string const units{content.begin(), content.end()};
+
+        std::string text;
+        for (std::span<char const> rest{units}; !rest.empty();)
+        {
+            auto const decoded{afv::buf::decode(rest)};
+            if (afv::buf::display_width(decoded.value) > layout.width())
+            {
+                text.append(layout.width(), '>');
+            }
+            else if (decoded.value < 0x20 || decoded.value == 0x7F)
+            {
+                text.push_back(' ');
+            }
+            else if (!decoded.valid)
+            {
+                text.append("\xEF\xBF\xBD");
+            }
+            else
+            {
+                text.append(rest.data(), decoded.length);
+            }
+
+            rest = rest.subspan(decoded.length);
+        }
+
+        mvaddnstr(y, 0, text.data(), static_cast<int>(text.size()));
+    }
+
+    void render_text(afv::buf::text_buffer const& buffer,
+        afv::layout_cache& layout,
+        afv::visual_row row,
+        int const rows)
+    {
+        for (int y{}; y != rows; ++y)
+        {
+            render_row(buffer, layout, row, y);
+
+            auto const next{layout.advance(row, 1)};
+            if (next == row)
+            {
+                break;
+            }
+            row = next;
+        }
+    }
+
+    void render_hex(afv::buf::text_buffer const& buffer,
+        std::size_t top,
+        int const rows)
+    {
+        auto const digits{afv::offset_digits(buffer.size())};
+        auto const count{
+            static_cast<std::size_t>(std::max(rows, 0)) * afv::hex_row_bytes};
+
+        // Only pages of the visible rows are read
+        std::vector<char> bytes;
+        bytes.reserve(count);
+        buffer.for_each_span(top,
+            count,
+            [&bytes](std::span<char const> span)
+            { bytes.insert(bytes.end(), span.begin(), span.end()); });
+
+        std::span<char const> rest{bytes};
+        for (int y{}; y != rows && !rest.empty(); ++y)
+        {
+            auto const row{
+                rest.first(std::min(rest.size(), afv::hex_row_bytes))};
+            auto const text{afv::format_hex_row(top, row, digits)};
+            mvaddnstr(y, 0, text.data(), static_cast<int>(text.size()));
+
+            top += row.size();
+            rest = rest.subspan(row.size());
+        }
+    }
+
+    // Reads an offset typed by the user, decimal or hexadecimal with a 0x
+    // prefix
+    [[nodiscard]] bool prompt_offset(std::size_t& offset)
+    {
+        std::array<char, 32> input{};
+        mvaddstr(LINES - 1, 0, "offset: ");
+        clrtoeol();
+        echo();
+        curs_set(1);
+        // Input isn't interrupted by polling of loading documents, the view
+        // sets the timeout again after the frame
+        timeout(-1);
+        auto const rv{getnstr(input.data(), static_cast<int>(input.size() - 1))};
+        curs_set(0);
+        noecho();
+        if (rv == ERR)
+        {
+            return false;
+        }
+
+        std::string_view text{input.data()};
+        int base{10};
+        if (text.starts_with("0x") || text.starts_with("0X"))
+        {
+            text.remove_prefix(2);
+            base = 16;
+        }
+
+        auto const last{std::next(text.data(),
+            static_cast<std::ptrdiff_t>(text.size()))};
+        auto const [ptr, ec]{std::from_chars(text.data(), last, offset, base)};
+        return !text.empty() && ec == std::errc{} && ptr == last;
+    }
+
+    enum class action
+    {
+        none,
+        quit,
+        down,
+        up,
+        page_down,
+        page_up,
+        first,
+        last,
+        toggle_mode,
+        jump,
+        next_document,
+        previous_document,
+        write_trace,
+        resize
+    };
+
+    [[nodiscard]] action action_for(int const key) noexcept
+    {
+        switch (key)
+        {
+        case 'q':
+            return action::quit;
+        case 'j':
+        case KEY_DOWN:
+            return action::down;
+        case 'k':
+        case KEY_UP:
+            return action::up;
+        case ' ':
+        case KEY_NPAGE:
+            return action::page_down;
+        case 'b':
+        case KEY_PPAGE:
+            return action::page_up;
+        case 'g':
+        case KEY_HOME:
+            return action::first;
+        case 'G':
+        case KEY_END:
+            return action::last;
+        case 'x':
+            return action::toggle_mode;
+        case ':':
+            return action::jump;
+        case '\t':
+        case 'n':
+            return action::next_document;
+        case KEY_BTAB:
+        case 'p':
+            return action::previous_document;
+        case 'T':
+            return action::write_trace;
+        case KEY_RESIZE:
+            return action::resize;
+        default:
+            return action::none;
+        }
+    }
+
+    // Scroll position of the hex view, offset of the first visible row
+    class [[nodiscard]] hex_position final
+    {
+    public: // Construction
+        explicit hex_position(std::size_t const size) : size_{size} { }
+
+    public: // Interface
+        [[nodiscard]] std::size_t offset() const noexcept { return offset_; }
+
+        void set_offset(std::size_t const offset) noexcept
+        {
+            auto const clamped{std::min(offset, last(1))};
+            offset_ = clamped - clamped % afv::hex_row_bytes;
+        }
+
+        void advance(std::ptrdiff_t const rows) noexcept
+        {
+            auto const bytes{
+                static_cast<std::size_t>(rows < 0 ? -rows : rows) *
+                afv::hex_row_bytes};
+            set_offset(rows < 0 ? offset_ - std::min(offset_, bytes)
+                                : offset_ + bytes);
+        }
+
+        // Offset of the first row of the last page
+        [[nodiscard]] std::size_t last(std::size_t const page) const noexcept
+        {
+            auto const rows{
+                (size_ + afv::hex_row_bytes - 1) / afv::hex_row_bytes};
+            return (rows - std::min(rows, page)) * afv::hex_row_bytes;
+        }
+
+    private: // Data
+        std::size_t size_;
+        std::size_t offset_{};
+    };
+
+    enum class document_state
+    {
+        loading,
+        ready,
+        failed
+    };
+
+    // File given on the command line, loaded by a worker thread
+    struct document final
+    {
+        std::string path;
+        std::optional<mapped_file> file;
+        afv::buf::text_buffer buffer;
+        bool binary{};
+        std::string error;
+        // Other members are written before the state is published
+        std::atomic<document_state> state{document_state::loading};
+    };
+
+    void load(document& doc, std::stop_token const& token)
+    {
+        try
+        {
+            // Text is copied so that a log truncated or rotated while it is
+            // viewed can't fault on pages of a mapping. Binary content is
+            // mapped and isn't indexed so that it opens without reading all
+            // of its pages.
+            doc.binary = !read_text(doc.path.c_str(), doc.buffer, token);
+            if (token.stop_requested())
+            {
+                return;
+            }
+
+            if (doc.binary)
+            {
+                doc.file.emplace(doc.path.c_str());
+                doc.buffer.insert_borrowed(0,
+                    doc.file->content(),
+                    afv::buf::indexing::offsets);
+            }
+            doc.state.store(document_state::ready, std::memory_order_release);
+        }
+        catch (std::exception const& ex)
+        {
+            doc.error = ex.what();
+            doc.state.store(document_state::failed, std::memory_order_release);
+        }
+    }
+
+    // Mode and scroll position of a loaded document
+    class [[nodiscard]] document_view final
+    {
+    public: // Construction
+        document_view(afv::buf::text_buffer const& buffer,
+            bool const binary,
+            std::size_t const width)
+            : buffer_{&buffer}
+            , mode_{binary ? view_mode::hex : view_mode::text}
+            , has_lines_{!binary}
+            , layout_{buffer, width}
+            , hex_{buffer.size()}
+        {
+        }
+
+    public: // Interface
+        void render(int const rows)
+        {
+            if (mode_ == view_mode::text)
+            {
+                render_text(*buffer_, layout_, top_, rows);
+            }
+            else
+            {
+                render_hex(*buffer_, hex_.offset(), rows);
+            }
+        }
+
+        [[nodiscard]] std::string status() const
+        {
+            if (mode_ == view_mode::text)
+            {
+                return fmt::format("line {}/{}",
+                    top_.line + 1,
+                    buffer_->lines());
+            }
+            return fmt::format("offset {:x}/{:x}",
+                hex_.offset(),
+                buffer_->size());
+        }
+
+        void handle(action const act, int const rows)
+        {
+            auto const page{static_cast<std::ptrdiff_t>(std::max(rows, 1))};
+            switch (act)
+            {
+            case action::down:
+                move_by(1);
+                break;
+            case action::up:
+                move_by(-1);
+                break;
+            case action::page_down:
+                move_by(page);
+                break;
+            case action::page_up:
+                move_by(-page);
+                break;
+            case action::first:
+                top_ = {};
+                hex_.set_offset(0);
+                break;
+            case action::last:
+                top_ = layout_.advance(layout_.last_row(), 1 - page);
+                hex_.set_offset(hex_.last(static_cast<std::size_t>(page)));
+                break;
+            case action::toggle_mode:
+                toggle_mode();
+                break;
+            case action::jump:
+                if (std::size_t offset{};
+                    mode_ == view_mode::hex && prompt_offset(offset))
+                {
+                    hex_.set_offset(offset);
+                }
+                break;
+            case action::resize:
+                resize();
+                break;
+            default:
+                break;
+            }
+        }
+
+    private: // Helpers
+        void move_by(std::ptrdiff_t const rows)
+        {
+            if (mode_ == view_mode::text)
+            {
+                top_ = layout_.advance(top_, rows);
+            }
+            else
+            {
+                hex_.advance(rows);
+            }
+        }
+
+        void resize()
+        {
+            // Top row keeps showing the same part of the line
+            auto const column{layout_.first_column(top_)};
+            layout_.set_width(static_cast<std::size_t>(COLS));
+            top_ = layout_.row_at(top_.line, column);
+        }
+
+        void toggle_mode()
+        {
+            if (mode_ == view_mode::text)
+            {
+                hex_.set_offset(buffer_->column_offset(top_.line,
+                    layout_.first_column(top_)));
+                mode_ = view_mode::hex;
+            }
+            else if (has_lines_) // Content without line index is only hex
+            {
+                auto const position{buffer_->position(hex_.offset())};
+                top_ = layout_.row_at(position.line, position.column);
+                mode_ = view_mode::text;
+            }
+        }
+
+    private: // Data
+        afv::buf::text_buffer const* buffer_;
+        view_mode mode_;
+        bool has_lines_;
+        afv::layout_cache layout_;
+        afv::visual_row top_{};
+        hex_position hex_;
+    };
+
+    void render_status(std::span<document const> const documents,
+        std::size_t const current,
+        std::optional<document_view> const& current_view)
+    {
+        auto const& doc{documents[current]};
+        auto text{fmt::format("[{}/{}] {} ",
+            current + 1,
+            documents.size(),
+            doc.path)};
+        // Document which became ready after views were created for this
+        // frame is shown as loading until the next one
+        if (current_view)
+        {
+            text.append(current_view->status());
+        }
+        else if (doc.state.load(std::memory_order_acquire) ==
+            document_state::failed)
+        {
+            text.append(doc.error);
+        }
+        else
+        {
+            text.append("loading");
+        }
+
+        if (auto const loading{std::ranges::count_if(documents,
+                [](document const& d)
+                {
+                    return d.state.load(std::memory_order_acquire) ==
+                        document_state::loading;
+                })};
+            loading != 0)
+        {
+            fmt::format_to(std::back_inserter(text),
+                " ({} loading)",
+                loading);
+        }
+
+        text.resize(static_cast<std::size_t>(std::max(COLS, 0)), ' ');
+        attron(A_REVERSE);
+        mvaddnstr(LINES - 1, 0, text.data(), static_cast<int>(text.size()));
+        attroff(A_REVERSE);
+    }
+
+    // Writes recorded trace events to the file named by AFV_TRACE_FILE
+    std::vector<afv::buf::trace_event> write_trace()
+    {
+        auto events{afv::buf::trace_events()};
+        char const* const path{std::getenv("AFV_TRACE_FILE")};
+        std::ofstream out{path == nullptr ? default_trace_file : path};
+        afv::buf::write_chrome_trace(out, events);
+        return events;
+    }
+
+    void view(std::span<document> const documents)
+    {
+        std::vector<std::optional<document_view>> views(documents.size());
+        std::size_t current{};
+
+        // Until the user switches documents the first loaded one is shown
+        bool follow_loaded{true};
+
+        // Frame is the time from reading a key to the terminal update
+        for (int key{ERR};; key = getch())
+        {
+            AFV_TRACE_SCOPE("frame");
+
+            // Status line is the last row
+            auto const rows{std::max(LINES - 1, 0)};
+            {
+                AFV_TRACE_SCOPE("input");
+                auto const act{action_for(key)};
+                switch (act)
+                {
+                case action::quit:
+                    return;
+                case action::next_document:
+                    current = (current + 1) % documents.size();
+                    follow_loaded = false;
+                    break;
+                case action::previous_document:
+                    current =
+                        (current + documents.size() - 1) % documents.size();
+                    follow_loaded = false;
+                    break;
+                case action::write_trace:
+                    if constexpr (afv::buf::tracing_enabled)
+                    {
+                        static_cast<void>(write_trace());
+                    }
+                    break;
+                case action::resize:
+                    for (auto& v : views)
+                    {
+                        if (v)
+                        {
+                            v->handle(act, rows);
+                        }
+                    }
+                    break;
+                default:
+                    if (auto& current_view{views[current]})
+                    {
+                        current_view->handle(act, rows);
+                    }
+                    break;
+                }
+            }
+
+            bool loading{false};
+            for (std::size_t i{}; i != documents.size(); ++i)
+            {
+                auto const state{
+                    documents[i].state.load(std::memory_order_acquire)};
+                if (state == document_state::ready && !views[i])
+                {
+                    views[i].emplace(documents[i].buffer,
+                        documents[i].binary,
+                        static_cast<std::size_t>(COLS));
+                    if (follow_loaded && !views[current])
+                    {
+                        current = i;
+                        follow_loaded = false;
+                    }
+                }
+                loading = loading || state == document_state::loading;
+            }
+
+            {
+                AFV_TRACE_SCOPE("render");
+                erase();
+                if (auto& current_view{views[current]})
+                {
+                    current_view->render(rows);
+                }
+                render_status(documents, current, views[current]);
+            }
+
+            {
+                AFV_TRACE_SCOPE("write");
+                refresh();
+            }
+
+            // Poll while documents are loading
+            timeout(loading ? 100 : -1);
+        }
+    }
+} // namespace
 
 namespace afv
 {
-    int run([[maybe_unused]] int argc, [[maybe_unused]] char** argv)
+    int run(int argc, char** argv)
     {
-        initscr(); /* Start curses mode 		  */
-        printw("Hello World !!!"); /* Print Hello World		  */
-        refresh(); /* Print it on to the real screen */
-        getch(); /* Wait for user input */
-        endwin(); /* End curses mode		  */
+        if (argc == 1)
+        {
+            fmt::print(stderr, "usage: afv FILE...\n");
+            return 1;
+        }
+
+        std::vector<document> documents(static_cast<std::size_t>(argc - 1));
+        for (std::size_t i{}; i != documents.size(); ++i)
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            documents[i].path = argv[i + 1];
+        }
+
+        // Documents are destroyed after the workers which load them finish.
+        // Loading waits for reads as much as it indexes, so there are more
+        // workers than cores on small machines.
+        loader const workers{documents.size(),
+            [&documents](std::size_t const i, std::stop_token const& token)
+            { load(documents[i], token); },
+            std::max<std::size_t>(std::thread::hardware_concurrency(),
+                min_loader_threads)};
+
+        setlocale(LC_ALL, "");
+        initscr();
+        cbreak();
+        noecho();
+        keypad(stdscr, TRUE);
+        curs_set(0);
+
+        view(documents);
+
+        endwin();
+
+        if constexpr (buf::tracing_enabled)
+        {
+            auto const events{write_trace()};
+            fmt::print(stderr,
+                "frame latency p50 {} us, p99 {} us\n",
+                buf::trace_percentile(events, "frame", 50) / 1000,
+                buf::trace_percentile(events, "frame", 99) / 1000);
+        }
 
         return 0;
     }
@@ -0,0 +1,45 @@
+#include <afv_loader.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+afv::loader::loader(std::size_t const count,
+    std::function<void(std::size_t, std::stop_token const&)> load,
+    std::size_t const max_threads)
+    : count_{count}
+    , load_{std::move(load)}
+{
+    auto const threads{std::min(count, std::max<std::size_t>(max_threads, 1))};
+    workers_.reserve(threads);
+    for (std::size_t i{}; i != threads; ++i)
+    {
+        workers_.emplace_back([this](std::stop_token const& token)
+            { work(token); });
+    }
+}
+
+afv::loader::~loader()
+{
+    // Workers stop together instead of one by one as they are joined
+    for (auto& worker : workers_)
+    {
+        worker.request_stop();
+    }
+}
+
+void afv::loader::work(std::stop_token const& token)
+{
+    while (!token.stop_requested())
+    {
+        auto const index{next_.fetch_add(1, std::memory_order_relaxed)};
+        if (index >= count_)
+        {
+            return;
+        }
+        load_(index, token);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace afv
+{
+    // Runs load(0, token) to load(count - 1, token) on a bounded number of
+    // worker threads. Workers take the next index as soon as they finish the
+    // previous one, so the total time approaches the time of the slowest job
+    // when there are enough threads. Destruction requests a stop through the
+    // token and waits for jobs which already started, jobs which didn't
+    // start are skipped.
+    class [[nodiscard]] loader final
+    {
+    public: // Construction
+        loader(std::size_t count,
+            std::function<void(std::size_t, std::stop_token const&)> load,
+            std::size_t max_threads = std::thread::hardware_concurrency());
+
+        loader(loader const&) = delete;
+
+        loader(loader&&) = delete;
+
+    public: // Destruction
+        ~loader();
+
+    public: // Operators
+        loader& operator=(loader const&) = delete;
+
+        loader& operator=(loader&&) = delete;
+
+    private: // Helpers
+        void work(std::stop_token const& token);
+
+    private: // Data
+        std::size_t count_;
+        std::function<void(std::size_t, std::stop_token const&)> load_;
+        std::atomic<std::size_t> next_{};
+        std::vector<std::jthread> workers_;
+    };
+} // namespace afv
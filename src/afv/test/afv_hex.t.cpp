@@ -0,0 +1,83 @@
+#include <afv_hex.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+TEST_CASE("afv::looks_binary")
+{
+    using namespace std::string_view_literals;
+
+    auto const binary = [](std::string_view const content)
+    { return afv::looks_binary(std::span{content}); };
+
+    SECTION("text is not binary")
+    {
+        REQUIRE_FALSE(binary(""sv));
+        REQUIRE_FALSE(binary("abc\r\ndef\n"sv));
+        REQUIRE_FALSE(binary("日本語\n"sv));
+    }
+
+    SECTION("text in other encodings is not binary")
+    {
+        REQUIRE_FALSE(binary("caf\xE9 na\xEFve\n"sv));
+        REQUIRE_FALSE(binary("abc\xFF"sv));
+        REQUIRE_FALSE(binary("abc\xE6\x97"sv));
+        REQUIRE_FALSE(binary("\x1B[31merror\x1B[0m\t\f\v\n"sv));
+    }
+
+    SECTION("NUL characters are binary")
+    {
+        REQUIRE(binary("abc\0def"sv));
+    }
+
+    SECTION("dense control characters are binary")
+    {
+        std::string content(64, 'a');
+        content[10] = '\x01';
+        content[20] = '\x7F';
+        REQUIRE_FALSE(binary(content));
+
+        content[30] = '\x02';
+        REQUIRE(binary(content));
+    }
+
+    SECTION("only the beginning of the content is checked")
+    {
+        std::string content(1 << 17, 'a');
+        content.back() = '\0';
+        REQUIRE_FALSE(binary(content));
+    }
+}
+
+TEST_CASE("afv::offset_digits")
+{
+    REQUIRE(afv::offset_digits(0) == 8);
+    REQUIRE(afv::offset_digits(0xFFFF'FFFF) == 8);
+    REQUIRE(afv::offset_digits(std::size_t{1} << 32) == 9);
+    REQUIRE(afv::offset_digits(std::size_t{1} << 40) == 11);
+}
+
+TEST_CASE("afv::format_hex_row")
+{
+    using namespace std::string_view_literals;
+
+    SECTION("full row")
+    {
+        REQUIRE(afv::format_hex_row(0x1'2345'6789,
+                    std::span{"0123456789:;<=>?"sv},
+                    9) ==
+            "123456789  30 31 32 33 34 35 36 37  38 39 3a 3b 3c 3d 3e 3f  "
+            "|0123456789:;<=>?|");
+    }
+
+    SECTION("partial row is padded and shows unprintable bytes as dots")
+    {
+        REQUIRE(afv::format_hex_row(0x10, std::span{"AB\x01"sv}, 8) ==
+            "00000010  41 42 01                                          "
+            "|AB.|");
+    }
+}
@@ -0,0 +1,191 @@
+#include <afv_layout.hpp>
+
+#include <afvbuf_text_buffer.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+TEST_CASE("afv::layout_cache")
+{
+    using namespace std::string_view_literals;
+
+    using afv::visual_row;
+
+    afv::buf::text_buffer buffer;
+    buffer.insert(0, "abcdefghij\n\nabc\n0123456789abcdefghijkl"sv);
+
+    afv::layout_cache layout{buffer, 4};
+
+    SECTION("rows() wraps lines at the width")
+    {
+        REQUIRE(layout.rows(0) == 3);
+        REQUIRE(layout.rows(1) == 1);
+        REQUIRE(layout.rows(2) == 1);
+        REQUIRE(layout.rows(3) == 6);
+        REQUIRE(layout.last_row() == visual_row{.line = 3, .row = 5});
+    }
+
+    SECTION("rows() counts display columns")
+    {
+        afv::buf::text_buffer wide;
+        wide.insert(0, "日本語"sv);
+
+        afv::layout_cache wide_layout{wide, 4};
+        REQUIRE(wide_layout.rows(0) == 2);
+    }
+
+    SECTION("wide characters which don't fit start the next row")
+    {
+        afv::buf::text_buffer wide;
+        wide.insert(0, "日日日日"sv);
+
+        afv::layout_cache wide_layout{wide, 3};
+        REQUIRE(wide_layout.rows(0) == 4);
+        REQUIRE(wide_layout.first_column({.line = 0, .row = 1}) == 2);
+        REQUIRE(wide_layout.first_column({.line = 0, .row = 3}) == 6);
+        REQUIRE(wide_layout.first_column({.line = 0, .row = 4}) == 8);
+        REQUIRE(wide_layout.row_at(0, 3) == visual_row{.line = 0, .row = 1});
+
+        wide_layout.set_width(1);
+        REQUIRE(wide_layout.rows(0) == 4);
+        REQUIRE(wide_layout.first_column({.line = 0, .row = 1}) == 2);
+        REQUIRE(wide_layout.row_at(0, 3) == visual_row{.line = 0, .row = 1});
+    }
+
+    SECTION("every character of a line is displayed in exactly one row")
+    {
+        // Wide characters between long runs of single column characters
+        std::string line;
+        for (std::size_t i{}; i != 50; ++i)
+        {
+            line.append(std::string(i * 37 % 400, 'a'));
+            line.append(i % 3 == 0 ? "日本" : "é日");
+        }
+
+        afv::buf::text_buffer mixed;
+        mixed.insert(0, "x\n"sv);
+        mixed.insert(mixed.size(), line);
+
+        constexpr std::array<std::size_t, 5> widths{1, 2, 3, 7, 80};
+        for (std::size_t const width : widths)
+        {
+            afv::layout_cache mixed_layout{mixed, width};
+
+            std::string displayed;
+            for (std::size_t row{}; row != mixed_layout.rows(1); ++row)
+            {
+                auto const first{
+                    mixed_layout.first_column({.line = 1, .row = row})};
+                auto const last{
+                    mixed_layout.first_column({.line = 1, .row = row + 1})};
+                REQUIRE(first < last);
+                REQUIRE((last - first <= width || last - first == 2));
+                REQUIRE(mixed_layout.row_at(1, first) ==
+                    visual_row{.line = 1, .row = row});
+
+                auto const content{mixed.line(1, first, last)};
+                displayed.append(content.begin(), content.end());
+            }
+
+            REQUIRE(displayed == line);
+        }
+    }
+
+    SECTION("set_width() drops cached row counts")
+    {
+        REQUIRE(layout.rows(0) == 3);
+
+        layout.set_width(5);
+        REQUIRE(layout.width() == 5);
+        REQUIRE(layout.rows(0) == 2);
+
+        layout.set_width(0);
+        REQUIRE(layout.width() == 1);
+        REQUIRE(layout.rows(0) == 10);
+    }
+
+    SECTION("advance() moves forward across lines")
+    {
+        REQUIRE(layout.advance({.line = 0, .row = 0}, 0) ==
+            visual_row{.line = 0, .row = 0});
+        REQUIRE(layout.advance({.line = 0, .row = 0}, 2) ==
+            visual_row{.line = 0, .row = 2});
+        REQUIRE(layout.advance({.line = 0, .row = 0}, 3) ==
+            visual_row{.line = 1, .row = 0});
+        REQUIRE(layout.advance({.line = 0, .row = 1}, 4) ==
+            visual_row{.line = 3, .row = 0});
+        REQUIRE(layout.advance({.line = 2, .row = 0}, 3) ==
+            visual_row{.line = 3, .row = 2});
+    }
+
+    SECTION("advance() moves backward across lines")
+    {
+        REQUIRE(layout.advance({.line = 3, .row = 5}, -5) ==
+            visual_row{.line = 3, .row = 0});
+        REQUIRE(layout.advance({.line = 3, .row = 5}, -6) ==
+            visual_row{.line = 2, .row = 0});
+        REQUIRE(layout.advance({.line = 2, .row = 0}, -2) ==
+            visual_row{.line = 0, .row = 2});
+        REQUIRE(layout.advance({.line = 1, .row = 0}, -3) ==
+            visual_row{.line = 0, .row = 0});
+    }
+
+    SECTION("advance() stops at the first and last row")
+    {
+        REQUIRE(layout.advance({.line = 0, .row = 1}, 100) ==
+            visual_row{.line = 3, .row = 5});
+        REQUIRE(layout.advance({.line = 3, .row = 2}, 100) ==
+            visual_row{.line = 3, .row = 5});
+        REQUIRE(layout.advance({.line = 2, .row = 0}, -100) ==
+            visual_row{.line = 0, .row = 0});
+        REQUIRE(layout.advance({.line = 0, .row = 1}, -100) ==
+            visual_row{.line = 0, .row = 0});
+    }
+
+    SECTION("invalidate() keeps layouts of lines which weren't edited")
+    {
+        REQUIRE(layout.rows(0) == 3);
+        REQUIRE(layout.rows(1) == 1);
+        REQUIRE(layout.rows(2) == 1);
+        REQUIRE(layout.rows(3) == 6);
+
+        // Line is added before the empty line, the line with abc changes
+        // too but isn't invalidated, so its cached layout is kept
+        buffer.insert(buffer.line_offset(2), "0123456789"sv);
+        buffer.insert(buffer.line_offset(1), "12345678\n"sv);
+        layout.invalidate(1, 0, 1);
+
+        REQUIRE(layout.rows(0) == 3);
+        REQUIRE(layout.rows(1) == 2);
+        REQUIRE(layout.rows(2) == 1);
+        REQUIRE(layout.rows(3) == 1);
+        REQUIRE(layout.rows(4) == 6);
+        REQUIRE(layout.last_row() == visual_row{.line = 4, .row = 5});
+
+        // Replaced line is laid out again
+        layout.invalidate(3, 1, 1);
+        REQUIRE(layout.rows(3) == 4);
+        REQUIRE(layout.rows(4) == 6);
+
+        // Layouts after removed lines move up
+        layout.invalidate(1, 2, 0);
+        REQUIRE(layout.rows(1) == 4);
+        REQUIRE(layout.rows(2) == 6);
+    }
+
+    SECTION("empty buffer has a single row")
+    {
+        afv::buf::text_buffer const empty;
+        afv::layout_cache empty_layout{empty, 4};
+
+        REQUIRE(empty_layout.last_row() == visual_row{.line = 0, .row = 0});
+        REQUIRE(empty_layout.advance({.line = 0, .row = 0}, 5) ==
+            visual_row{.line = 0, .row = 0});
+        REQUIRE(empty_layout.advance({.line = 0, .row = 0}, -5) ==
+            visual_row{.line = 0, .row = 0});
+    }
+}
@@ -0,0 +1,81 @@
+#include <afv_loader.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+TEST_CASE("afv::loader")
+{
+    // Destruction skips jobs which didn't start
+    auto const wait_for = [](std::atomic<std::size_t> const& counter,
+                              std::size_t const value)
+    {
+        while (counter.load() != value)
+        {
+            std::this_thread::yield();
+        }
+    };
+
+    SECTION("every job runs once")
+    {
+        constexpr std::size_t jobs{100};
+        std::vector<std::atomic<int>> runs(jobs);
+        std::atomic<std::size_t> finished{};
+        {
+            afv::loader const workers{jobs,
+                [&](std::size_t const i, std::stop_token const&)
+                {
+                    runs[i].fetch_add(1);
+                    finished.fetch_add(1);
+                },
+                4};
+            wait_for(finished, jobs);
+        }
+
+        for (auto const& run : runs)
+        {
+            REQUIRE(run.load() == 1);
+        }
+    }
+
+    SECTION("jobs run on at least one thread")
+    {
+        std::atomic<std::size_t> runs{};
+        {
+            afv::loader const workers{3,
+                [&runs](std::size_t, std::stop_token const&)
+                { runs.fetch_add(1); },
+                0};
+            wait_for(runs, 3);
+        }
+        REQUIRE(runs.load() == 3);
+    }
+
+    SECTION("destruction stops running jobs and skips the rest")
+    {
+        std::atomic<std::size_t> started{};
+        std::atomic<std::size_t> stopped{};
+        {
+            afv::loader const workers{10,
+                [&](std::size_t, std::stop_token const& token)
+                {
+                    started.fetch_add(1);
+                    while (!token.stop_requested())
+                    {
+                        std::this_thread::yield();
+                    }
+                    stopped.fetch_add(1);
+                },
+                2};
+
+            wait_for(started, 2);
+        }
+
+        REQUIRE(started.load() == 2);
+        REQUIRE(stopped.load() == 2);
+    }
+}
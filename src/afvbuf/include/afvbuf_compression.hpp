@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+namespace afv::buf
+{
+    // Block codec in the LZ77 family: sequences of literal bytes followed by
+    // a copy of at least four bytes from the previous 64 KiB of output. It
+    // favors speed over ratio, text typically compresses to a third or half
+    // of its size.
+
+    // Size of the output buffer needed to compress data of the size
+    [[nodiscard]] std::size_t compress_bound(std::size_t size) noexcept;
+
+    // Compresses data into output of at least compress_bound(data.size())
+    // bytes and returns the size of the compressed data
+    [[nodiscard]] std::size_t compress(std::span<std::byte const> data,
+        std::span<std::byte> output) noexcept;
+
+    // Decompresses data created by compress() into output of the size of the
+    // original data
+    void decompress(std::span<std::byte const> data,
+        std::span<std::byte> output) noexcept;
+} // namespace afv::buf
@@ -0,0 +1,406 @@
+#pragma once
+
+#include <afvbuf_text_buffer.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace afv::buf
+{
+    // Changed region of two versions of content. Line ranges contain every
+    // line touched by the change, they are empty at the line where content
+    // was only removed from the other version.
+    struct diff_hunk final
+    {
+        std::size_t old_offset{};
+        std::size_t old_length{};
+        std::size_t new_offset{};
+        std::size_t new_length{};
+        std::size_t old_first_line{};
+        std::size_t old_last_line{};
+        std::size_t new_first_line{};
+        std::size_t new_last_line{};
+
+        friend constexpr bool operator==(diff_hunk const&,
+            diff_hunk const&) noexcept = default;
+    };
+
+    namespace detail
+    {
+        // Changed regions with more differences aren't diffed by characters
+        inline constexpr std::size_t max_diff_distance{1024};
+
+        // Part of a piece which is either shared by both versions or not
+        // present in the other version at all
+        struct atom final
+        {
+            std::size_t buffer_index{};
+            std::size_t start_offset{};
+            std::size_t length{};
+
+            friend constexpr bool operator==(atom const&,
+                atom const&) noexcept = default;
+        };
+
+        // Equal elements old[old_index, old_index + length) and
+        // new[new_index, new_index + length)
+        struct diff_run final
+        {
+            std::size_t old_index{};
+            std::size_t new_index{};
+            std::size_t length{};
+        };
+
+        // Runs of the shortest edit script of sequences of old_size and
+        // new_size elements, std::nullopt when the edit distance is larger
+        // than max_distance
+        template<typename Equal>
+        [[nodiscard]] constexpr std::optional<std::vector<diff_run>> myers(
+            std::size_t old_size,
+            std::size_t new_size,
+            Equal equal,
+            std::size_t max_distance)
+        {
+            auto const n{static_cast<std::ptrdiff_t>(old_size)};
+            auto const m{static_cast<std::ptrdiff_t>(new_size)};
+            auto const max{std::min(static_cast<std::ptrdiff_t>(max_distance),
+                n + m)};
+
+            // Furthest x on each diagonal k = x - y, trace of step d holds
+            // diagonals [-d, d] before the step at trace[d * d]
+            std::vector<std::ptrdiff_t> v(static_cast<std::size_t>(2 * max + 3));
+            std::vector<std::ptrdiff_t> trace;
+            auto const at = [&v, max](std::ptrdiff_t k) -> std::ptrdiff_t&
+            { return v[static_cast<std::size_t>(k + max + 1)]; };
+
+            for (std::ptrdiff_t d{}; d <= max; ++d)
+            {
+                for (auto k{-d}; k <= d; ++k)
+                {
+                    trace.push_back(at(k));
+                }
+
+                for (auto k{-d}; k <= d; k += 2)
+                {
+                    auto x{k == -d || (k != d && at(k - 1) < at(k + 1))
+                            ? at(k + 1)
+                            : at(k - 1) + 1};
+                    auto y{x - k};
+                    while (x < n && y < m &&
+                        equal(static_cast<std::size_t>(x),
+                            static_cast<std::size_t>(y)))
+                    {
+                        ++x;
+                        ++y;
+                    }
+                    at(k) = x;
+
+                    if (x < n || y < m)
+                    {
+                        continue;
+                    }
+
+                    // Walk back through the trace collecting diagonal runs
+                    std::vector<diff_run> rv;
+                    for (auto step{d}; step >= 0; --step)
+                    {
+                        auto const diagonal{x - y};
+                        auto const before = [&trace, step](std::ptrdiff_t i)
+                        {
+                            return trace[static_cast<std::size_t>(
+                                step * step + i + step)];
+                        };
+
+                        std::ptrdiff_t start_x{};
+                        std::ptrdiff_t previous_x{};
+                        std::ptrdiff_t previous_k{};
+                        if (step != 0)
+                        {
+                            bool const down{diagonal == -step ||
+                                (diagonal != step &&
+                                    before(diagonal - 1) <
+                                        before(diagonal + 1))};
+                            previous_k = down ? diagonal + 1 : diagonal - 1;
+                            previous_x = before(previous_k);
+                            start_x = down ? previous_x : previous_x + 1;
+                        }
+
+                        if (x != start_x)
+                        {
+                            rv.push_back(
+                                {.old_index = static_cast<std::size_t>(start_x),
+                                    .new_index = static_cast<std::size_t>(
+                                        start_x - diagonal),
+                                    .length = static_cast<std::size_t>(
+                                        x - start_x)});
+                        }
+                        x = previous_x;
+                        y = previous_x - previous_k;
+                    }
+                    std::ranges::reverse(rv);
+                    return rv;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        template<typename CharT, typename Traits, typename Allocator>
+        [[nodiscard]] constexpr std::vector<CharT> copy_range(
+            basic_text_buffer<CharT, Traits, Allocator> const& buffer,
+            std::size_t offset,
+            std::size_t count)
+        {
+            std::vector<CharT> rv;
+            rv.reserve(count);
+            buffer.for_each_span(offset,
+                count,
+                [&rv](std::span<CharT const> span)
+                { rv.insert(rv.end(), span.begin(), span.end()); });
+            return rv;
+        }
+
+        // Pieces of both versions split where a piece of either version
+        // starts or ends in the same buffer
+        template<std::ranges::sized_range Pieces>
+        requires std::same_as<std::ranges::range_value_t<Pieces>, text_piece>
+        [[nodiscard]] constexpr std::pair<std::vector<atom>,
+            std::vector<atom>>
+        split_atoms(Pieces const& old_pieces, Pieces const& new_pieces)
+        {
+            std::vector<std::pair<std::size_t, std::size_t>> boundaries;
+            boundaries.reserve(2 * (std::ranges::size(old_pieces) +
+                                       std::ranges::size(new_pieces)));
+            for (auto const& pieces : {old_pieces, new_pieces})
+            {
+                for (text_piece const piece : pieces)
+                {
+                    boundaries.emplace_back(piece.buffer_index,
+                        piece.start_offset);
+                    boundaries.emplace_back(piece.buffer_index,
+                        piece.start_offset + piece.length);
+                }
+            }
+            std::ranges::sort(boundaries);
+            auto const duplicates{std::ranges::unique(boundaries)};
+            boundaries.erase(duplicates.begin(), duplicates.end());
+
+            auto const split = [&boundaries](Pieces const& pieces)
+            {
+                std::vector<atom> rv;
+                rv.reserve(std::ranges::size(pieces));
+                for (text_piece const piece : pieces)
+                {
+                    auto const last{piece.start_offset + piece.length};
+                    auto it{std::ranges::upper_bound(boundaries,
+                        std::pair{piece.buffer_index, piece.start_offset})};
+                    for (auto start{piece.start_offset}; start != last; ++it)
+                    {
+                        auto const end{std::min(it->second, last)};
+                        rv.push_back({.buffer_index = piece.buffer_index,
+                            .start_offset = start,
+                            .length = end - start});
+                        start = end;
+                    }
+                }
+                return rv;
+            };
+
+            return {split(old_pieces), split(new_pieces)};
+        }
+
+        // Appends changes between old[old_offset, old_offset + old_length)
+        // and new[new_offset, new_offset + new_length) found by comparing
+        // their characters
+        template<typename CharT, typename Traits, typename Allocator>
+        constexpr void diff_characters(
+            basic_text_buffer<CharT, Traits, Allocator> const& old_version,
+            basic_text_buffer<CharT, Traits, Allocator> const& new_version,
+            diff_hunk region,
+            std::vector<diff_hunk>& hunks)
+        {
+            auto const old_text{copy_range(old_version,
+                region.old_offset,
+                region.old_length)};
+            auto const new_text{copy_range(new_version,
+                region.new_offset,
+                region.new_length)};
+
+            auto const [old_rest, new_rest]{
+                std::ranges::mismatch(old_text, new_text)};
+            auto const prefix{static_cast<std::size_t>(
+                std::distance(old_text.cbegin(), old_rest))};
+            auto const [old_end, new_end]{std::ranges::mismatch(
+                old_text.crbegin(),
+                std::prev(old_text.crend(),
+                    static_cast<std::ptrdiff_t>(prefix)),
+                new_text.crbegin(),
+                std::prev(new_text.crend(),
+                    static_cast<std::ptrdiff_t>(prefix)))};
+            auto const suffix{static_cast<std::size_t>(
+                std::distance(old_text.crbegin(), old_end))};
+
+            auto const old_size{old_text.size() - prefix - suffix};
+            auto const new_size{new_text.size() - prefix - suffix};
+            if (old_size == 0 && new_size == 0)
+            {
+                return;
+            }
+
+            // Content only inserted or only removed is a single change
+            auto const equal = [&](std::size_t i, std::size_t j)
+            { return old_text[prefix + i] == new_text[prefix + j]; };
+            auto const runs{old_size == 0 || new_size == 0
+                    ? std::nullopt
+                    : myers(old_size, new_size, equal, max_diff_distance)};
+            if (!runs)
+            {
+                hunks.push_back({.old_offset = region.old_offset + prefix,
+                    .old_length = old_size,
+                    .new_offset = region.new_offset + prefix,
+                    .new_length = new_size});
+                return;
+            }
+
+            std::size_t old_index{};
+            std::size_t new_index{};
+            auto const add_change = [&](std::size_t old_end_index,
+                                        std::size_t new_end_index)
+            {
+                if (old_index != old_end_index || new_index != new_end_index)
+                {
+                    hunks.push_back({.old_offset =
+                                         region.old_offset + prefix + old_index,
+                        .old_length = old_end_index - old_index,
+                        .new_offset = region.new_offset + prefix + new_index,
+                        .new_length = new_end_index - new_index});
+                }
+            };
+            for (diff_run const& run : *runs)
+            {
+                add_change(run.old_index, run.new_index);
+                old_index = run.old_index + run.length;
+                new_index = run.new_index + run.length;
+            }
+            add_change(old_size, new_size);
+        }
+
+        // Lines touched by [offset, offset + length) range
+        template<typename CharT, typename Traits, typename Allocator>
+        [[nodiscard]] constexpr std::pair<std::size_t, std::size_t>
+        touched_lines(basic_text_buffer<CharT, Traits, Allocator> const& buffer,
+            std::size_t offset,
+            std::size_t length) noexcept
+        {
+            auto const first{buffer.position(offset).line};
+            if (length == 0)
+            {
+                return {first, first};
+            }
+            return {first, buffer.position(offset + length - 1).line + 1};
+        }
+    } // namespace detail
+
+    // Changes between two versions of content, in order. Pieces shared by
+    // the versions are matched by their identity in a single pass and only
+    // the rest is compared by characters, so the cost depends on the number
+    // of pieces and the size of the changes and not on the size of the
+    // content. The new version has to be a copy of the old version edited by
+    // insertions, versions edited independently of each other after a copy
+    // and content modified through mutable iterators aren't supported.
+    template<typename CharT, typename Traits, typename Allocator>
+    [[nodiscard]] constexpr std::vector<diff_hunk> diff(
+        basic_text_buffer<CharT, Traits, Allocator> const& old_version,
+        basic_text_buffer<CharT, Traits, Allocator> const& new_version)
+    {
+        auto const [old_atoms, new_atoms]{detail::split_atoms(
+            old_version.pieces(),
+            new_version.pieces())};
+
+        // Shared atoms are in the same order in both versions, atoms of the
+        // new version which don't match the next shared atom were inserted.
+        // Regions between shared atoms are compared by characters.
+        std::vector<diff_hunk> changes;
+        diff_hunk region;
+        auto const next_region = [&]()
+        {
+            if (region.old_length != 0 || region.new_length != 0)
+            {
+                detail::diff_characters(old_version,
+                    new_version,
+                    region,
+                    changes);
+            }
+            region = {.old_offset = region.old_offset + region.old_length,
+                .new_offset = region.new_offset + region.new_length};
+        };
+
+        auto old_it{old_atoms.cbegin()};
+        for (detail::atom const& new_atom : new_atoms)
+        {
+            if (old_it != old_atoms.cend() && *old_it == new_atom)
+            {
+                next_region();
+                region.old_offset += new_atom.length;
+                region.new_offset += new_atom.length;
+                ++old_it;
+            }
+            else
+            {
+                region.new_length += new_atom.length;
+            }
+        }
+
+        // Atoms of the old version which weren't found
+        for (; old_it != old_atoms.cend(); ++old_it)
+        {
+            region.old_length += old_it->length;
+        }
+        next_region();
+
+        // Changes touching the same line are reported as one hunk
+        std::vector<diff_hunk> rv;
+        for (diff_hunk change : changes)
+        {
+            std::tie(change.old_first_line, change.old_last_line) =
+                detail::touched_lines(old_version,
+                    change.old_offset,
+                    change.old_length);
+            std::tie(change.new_first_line, change.new_last_line) =
+                detail::touched_lines(new_version,
+                    change.new_offset,
+                    change.new_length);
+
+            // Changes removing whole lines touch no lines but still share
+            // the line they are removed at with the following change
+            if (!rv.empty() &&
+                (change.old_first_line < std::max(rv.back().old_last_line,
+                                             rv.back().old_first_line + 1) ||
+                    change.new_first_line <
+                        std::max(rv.back().new_last_line,
+                            rv.back().new_first_line + 1)))
+            {
+                auto& last{rv.back()};
+                last.old_length =
+                    change.old_offset + change.old_length - last.old_offset;
+                last.new_length =
+                    change.new_offset + change.new_length - last.new_offset;
+                last.old_last_line =
+                    std::max(last.old_last_line, change.old_last_line);
+                last.new_last_line =
+                    std::max(last.new_last_line, change.new_last_line);
+                continue;
+            }
+            rv.push_back(change);
+        }
+        return rv;
+    }
+} // namespace afv::buf
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <afvbuf_text_buffer.hpp>
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace afv::buf
+{
+    // Lexer state at the start of each line of a text buffer. The lexer is
+    // called with the state at the start of a line and the content of the
+    // line and returns the state at the start of the next line. States are
+    // calculated on demand up to the requested line. After an edit only the
+    // edited lines are lexed again, followed by lines up to the first one
+    // where the state matches the state from before the edit, so the cost
+    // of an edit depends on how far the change of state ripples and not on
+    // the size of the buffer.
+    template<std::equality_comparable State, std::copy_constructible Lexer>
+    requires std::copy_constructible<State>
+    class [[nodiscard]] line_state_cache final
+    {
+    public: // Construction
+        constexpr explicit line_state_cache(Lexer lexer, State initial = {})
+            : lexer_{std::move(lexer)}
+            , states_{stored_state{std::move(initial)}}
+        {
+        }
+
+        constexpr line_state_cache(line_state_cache const&) = default;
+
+        constexpr line_state_cache(line_state_cache&&) noexcept = default;
+
+    public: // Destruction
+        ~line_state_cache() = default;
+
+    public: // Interface
+        // State at the start of the line, line can be one past the last line
+        // of the buffer. The reference is valid until the next call.
+        template<typename CharT, typename Traits, typename Allocator>
+        requires std::invocable<Lexer&,
+            State const&,
+            std::ranges::subrange<
+                basic_text_buffer_const_iterator<CharT, Traits, Allocator>>>
+        [[nodiscard]] constexpr State const& state(
+            basic_text_buffer<CharT, Traits, Allocator> const& buffer,
+            std::size_t line);
+
+        // Lines [line, line + removed) of the buffer were replaced by added
+        // lines, has to be called for every edit of the buffer
+        constexpr void invalidate(std::size_t line,
+            std::size_t removed,
+            std::size_t added);
+
+    public: // Operators
+        constexpr line_state_cache& operator=(
+            line_state_cache const&) = default;
+
+        constexpr line_state_cache& operator=(
+            line_state_cache&&) noexcept = default;
+
+    private: // Types
+        // Keeps std::vector<bool> from being used for bool states
+        struct stored_state final
+        {
+            State state;
+        };
+
+        // Stored states in [first, last) range are placeholders for lines
+        // added by an edit or were already lexed again after it, states from
+        // last on are from before the edit
+        struct stale_range final
+        {
+            std::size_t first{};
+            std::size_t last{};
+        };
+
+    private: // Data
+        Lexer lexer_;
+        std::vector<stored_state> states_;
+        // States before this line are up to date
+        std::size_t valid_{1};
+        std::vector<stale_range> stale_;
+    };
+
+    template<std::equality_comparable State, std::copy_constructible Lexer>
+    requires std::copy_constructible<State>
+    template<typename CharT, typename Traits, typename Allocator>
+    requires std::invocable<Lexer&,
+        State const&,
+        std::ranges::subrange<
+            basic_text_buffer_const_iterator<CharT, Traits, Allocator>>>
+    constexpr State const& line_state_cache<State, Lexer>::state(
+        basic_text_buffer<CharT, Traits, Allocator> const& buffer,
+        std::size_t const line)
+    {
+        while (valid_ <= line)
+        {
+            auto const previous{valid_ - 1};
+            State next{std::invoke(lexer_,
+                std::as_const(states_[previous].state),
+                buffer.line(previous))};
+
+            if (valid_ == states_.size())
+            {
+                stale_.clear();
+                states_.push_back({std::move(next)});
+                ++valid_;
+                continue;
+            }
+
+            // Change of state rippled into lines of the following edit
+            if (stale_.size() > 1 && valid_ >= stale_[1].first)
+            {
+                stale_.front().last =
+                    std::max(stale_.front().last, stale_[1].last);
+                stale_.erase(std::next(stale_.begin()));
+            }
+
+            if (valid_ >= stale_.front().last &&
+                states_[valid_].state == next)
+            {
+                // States from before the edit are valid from here on
+                stale_.erase(stale_.begin());
+                valid_ = stale_.empty() ? states_.size() : stale_.front().first;
+                continue;
+            }
+
+            states_[valid_].state = std::move(next);
+            ++valid_;
+            stale_.front().last = std::max(stale_.front().last, valid_);
+        }
+
+        return states_[line].state;
+    }
+
+    template<std::equality_comparable State, std::copy_constructible Lexer>
+    requires std::copy_constructible<State>
+    constexpr void line_state_cache<State, Lexer>::invalidate(
+        std::size_t const line,
+        std::size_t const removed,
+        std::size_t const added)
+    {
+        if (line + 1 >= states_.size())
+        {
+            return;
+        }
+
+        // State at the start of the first line after the edit is from
+        // before the edit, unless all edited lines were removed
+        auto const tail_first{line + removed + (added == 0 ? 1 : 0)};
+        auto const new_first{tail_first - removed + added};
+        auto const remap = [&](std::size_t const index,
+                               std::size_t const replaced)
+        {
+            if (index <= line)
+            {
+                return index;
+            }
+            return index < tail_first ? replaced : index - removed + added;
+        };
+
+        // States are moved once in place, not at all when the number of
+        // lines didn't change. States kept in place of replaced lines are
+        // overwritten before they are used.
+        auto const first{
+            std::next(states_.begin(), static_cast<std::ptrdiff_t>(line + 1))};
+        bool const has_tail{tail_first < states_.size()};
+        if (!has_tail)
+        {
+            states_.erase(first, states_.end());
+        }
+        else if (new_first > tail_first)
+        {
+            stored_state const placeholder{states_[line]};
+            states_.insert(first, new_first - tail_first, placeholder);
+        }
+        else if (new_first < tail_first)
+        {
+            states_.erase(first,
+                std::next(first,
+                    static_cast<std::ptrdiff_t>(tail_first - new_first)));
+        }
+
+        for (auto& range : stale_)
+        {
+            range = {.first = remap(range.first, line + 1),
+                .last = std::min(remap(range.last, new_first), states_.size())};
+        }
+        if (has_tail)
+        {
+            stale_.push_back({.first = line + 1, .last = new_first});
+        }
+        std::ranges::sort(stale_, {}, &stale_range::first);
+
+        // Ranges touching each other ripple together
+        auto merged{stale_.begin()};
+        for (auto it{stale_.begin()};
+             it != stale_.end() && it->first < states_.size();
+             ++it)
+        {
+            if (merged != stale_.begin() &&
+                it->first <= std::prev(merged)->last)
+            {
+                std::prev(merged)->last =
+                    std::max(std::prev(merged)->last, it->last);
+                continue;
+            }
+            *merged++ = *it;
+        }
+        stale_.erase(merged, stale_.end());
+
+        valid_ = std::min({valid_, line + 1, states_.size()});
+    }
+} // namespace afv::buf
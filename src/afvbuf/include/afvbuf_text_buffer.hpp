@@ -1,31 +1,752 @@
 #pragma once
 
+#include <afvbuf_compression.hpp>
+#include <afvbuf_trace.hpp>
+#include <afvbuf_unicode.hpp>
+
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <memory_resource>
 #include <ranges>
 #include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace afv::buf
 {
+    enum class line_ending : std::uint8_t
+    {
+        none,
+        lf,
+        crlf,
+        cr,
+        mixed
+    };
+
+    // Properties of content calculated when it is inserted
+    enum class indexing : std::uint8_t
+    {
+        // Line terminators, code points and display columns
+        full,
+        // Offsets only, content is a single line where every code unit is a
+        // code point one column wide
+        offsets
+    };
+
     namespace detail
     {
+        // Number of code units between stored code point and column counts
+        inline constexpr std::size_t checkpoint_interval{4096};
+
+        // Smaller buffers are never compressed
+        inline constexpr std::size_t min_compressed_bytes{16384};
+
+        // Number of line terminators of each style
+        struct line_ending_counts final
+        {
+            std::size_t lf{};
+            std::size_t crlf{};
+            std::size_t cr{};
+
+            constexpr line_ending_counts& operator+=(
+                line_ending_counts const& other) noexcept
+            {
+                lf += other.lf;
+                crlf += other.crlf;
+                cr += other.cr;
+                return *this;
+            }
+
+            constexpr line_ending_counts& operator-=(
+                line_ending_counts const& other) noexcept
+            {
+                lf -= other.lf;
+                crlf -= other.crlf;
+                cr -= other.cr;
+                return *this;
+            }
+        };
+
+        inline constexpr line_ending_counts lf_terminator{.lf = 1};
+        inline constexpr line_ending_counts crlf_terminator{.crlf = 1};
+        inline constexpr line_ending_counts cr_terminator{.cr = 1};
+
+        template<typename CharT>
+        inline constexpr std::array<CharT, 2> crlf{CharT{'\r'}, CharT{'\n'}};
+
+        // Traits::find of std::char_traits uses memchr for single byte and
+        // wmemchr for wchar_t code units, other code units are searched
+        // several at a time in 64-bit words
+        template<typename CharT, typename Traits>
+        inline constexpr bool has_find_kernel{
+            !std::same_as<Traits, std::char_traits<CharT>> ||
+            sizeof(CharT) == 1 || std::same_as<CharT, wchar_t>};
+
+        // Index of the first code unit equal to the value in the
+        // [first, text.size()) range, text.size() if there is none
+        template<typename CharT, typename Traits>
+        [[nodiscard]] constexpr std::size_t find_code_unit(
+            std::span<CharT const> text,
+            std::size_t first,
+            CharT value) noexcept
+        {
+            if constexpr (has_find_kernel<CharT, Traits>)
+            {
+                auto const* const found{Traits::find(text.data() + first,
+                    text.size() - first,
+                    value)};
+                return found == nullptr
+                    ? text.size()
+                    : static_cast<std::size_t>(found - text.data());
+            }
+            else
+            {
+                if constexpr (std::endian::native == std::endian::little)
+                {
+                    if (!std::is_constant_evaluated())
+                    {
+                        // Code units equal to the value are zero after xor,
+                        // the first zero code unit is the lowest one with
+                        // its high bit set after subtraction of ones
+                        using word = std::uint64_t;
+                        constexpr auto unit_bits{8 * sizeof(CharT)};
+                        constexpr auto units{sizeof(word) / sizeof(CharT)};
+                        constexpr auto ones{
+                            ~word{} / ((word{1} << unit_bits) - 1)};
+                        constexpr auto high_bits{ones << (unit_bits - 1)};
+
+                        auto const pattern{ones * code_unit(value)};
+                        for (; first + units <= text.size(); first += units)
+                        {
+                            word w{};
+                            std::memcpy(&w, text.data() + first, sizeof(w));
+                            w ^= pattern;
+                            if (auto const zero{(w - ones) & ~w & high_bits};
+                                zero != 0)
+                            {
+                                return first +
+                                    static_cast<std::size_t>(
+                                        std::countr_zero(zero)) /
+                                    unit_bits;
+                            }
+                        }
+                    }
+                }
+
+                for (; first != text.size(); ++first)
+                {
+                    if (text[first] == value)
+                    {
+                        return first;
+                    }
+                }
+                return text.size();
+            }
+        }
+
         template<typename CharT, typename Traits, typename Allocator>
-        using buffer = std::basic_string<CharT, Traits, Allocator>;
+        class buffer final
+        {
+        public: // Types
+            using allocator_type = Allocator;
+            using size_type = std::allocator_traits<Allocator>::size_type;
+            using text_type = std::basic_string<CharT, Traits, Allocator>;
+
+        private:
+            using index_allocator = std::allocator_traits<
+                Allocator>::template rebind_alloc<size_type>;
+
+            using index_container = std::vector<size_type, index_allocator>;
+
+            using style_allocator = std::allocator_traits<
+                Allocator>::template rebind_alloc<line_ending>;
+
+            using style_container = std::vector<line_ending, style_allocator>;
+
+            using byte_allocator = std::allocator_traits<
+                Allocator>::template rebind_alloc<std::byte>;
+
+            using byte_container = std::vector<std::byte, byte_allocator>;
+
+        public: // Construction
+            constexpr explicit buffer(text_type text,
+                Allocator const& alloc = Allocator{})
+                : text_{std::move(text), alloc}
+                , size_{text_.size()}
+                , compressed_{alloc}
+                , newlines_{alloc}
+                , styles_{alloc}
+                , code_points_{alloc}
+                , columns_{alloc}
+            {
+                index();
+            }
+
+            // Content is borrowed and must outlive the buffer
+            constexpr buffer(std::span<CharT> borrowed,
+                indexing mode,
+                Allocator const& alloc = Allocator{})
+                : text_{alloc}
+                , compressed_{alloc}
+                , borrowed_{borrowed}
+                , newlines_{alloc}
+                , styles_{alloc}
+                , code_points_{alloc}
+                , columns_{alloc}
+                , indexed_{mode == indexing::full}
+            {
+                if (indexed_)
+                {
+                    index();
+                }
+            }
+
+            constexpr buffer(buffer const&) = default;
+
+            constexpr buffer(buffer const& other, Allocator const& alloc)
+                : text_{other.text_, alloc}
+                , size_{other.size_}
+                , compressed_{other.compressed_, alloc}
+                , borrowed_{other.borrowed_}
+                , newlines_{other.newlines_, alloc}
+                , styles_{other.styles_, alloc}
+                , code_points_{other.code_points_, alloc}
+                , columns_{other.columns_, alloc}
+                , line_endings_{other.line_endings_}
+                , ascii_{other.ascii_}
+                , indexed_{other.indexed_}
+                , compressible_{other.compressible_}
+                , tracked_{other.tracked_}
+                , referenced_{other.referenced_}
+                , last_use_{other.last_use_}
+            {
+            }
+
+            constexpr buffer(buffer&&) noexcept = default;
+
+            constexpr buffer(buffer&& other, Allocator const& alloc)
+                : text_{std::move(other.text_), alloc}
+                , size_{other.size_}
+                , compressed_{std::move(other.compressed_), alloc}
+                , borrowed_{other.borrowed_}
+                , newlines_{std::move(other.newlines_), alloc}
+                , styles_{std::move(other.styles_), alloc}
+                , code_points_{std::move(other.code_points_), alloc}
+                , columns_{std::move(other.columns_), alloc}
+                , line_endings_{other.line_endings_}
+                , ascii_{other.ascii_}
+                , indexed_{other.indexed_}
+                , compressible_{other.compressible_}
+                , tracked_{other.tracked_}
+                , referenced_{other.referenced_}
+                , last_use_{other.last_use_}
+            {
+            }
+
+        public: // Destruction
+            ~buffer() = default;
+
+        public: // Interface
+            [[nodiscard]] constexpr size_type size() const noexcept
+            {
+                return borrowed_.empty() ? size_ : borrowed_.size();
+            }
+
+            // Decompresses content which was compressed
+            [[nodiscard]] constexpr std::span<CharT const> text() const noexcept
+            {
+                if (borrowed_.empty())
+                {
+                    load();
+                    return text_;
+                }
+                return borrowed_;
+            }
+
+            // Content as it is held, valid only after text() was called since
+            // the content was last compressed
+            [[nodiscard]] constexpr std::span<CharT const>
+            loaded_text() const noexcept
+            {
+                if (borrowed_.empty())
+                {
+                    return text_;
+                }
+                return borrowed_;
+            }
+
+            // Line terminators of content which isn't indexed are not counted
+            [[nodiscard]] constexpr bool indexed() const noexcept
+            {
+                return indexed_;
+            }
+
+            // Number of code units held uncompressed in memory, borrowed
+            // content isn't counted
+            [[nodiscard]] constexpr size_type resident_size() const noexcept
+            {
+                return text_.size();
+            }
+
+            // Value of the clock when the content was last accessed
+            [[nodiscard]] constexpr std::uint64_t last_use() const noexcept
+            {
+                return last_use_;
+            }
+
+            // Content accessed since the previous tick was used at the tick.
+            // Accesses are recorded only after the first tick.
+            constexpr void tick(std::uint64_t clock) noexcept
+            {
+                tracked_ = true;
+                if (referenced_)
+                {
+                    last_use_ = clock;
+                    referenced_ = false;
+                }
+            }
+
+            // Releases uncompressed content, returns false for borrowed,
+            // small and incompressible content. Compressed content is kept
+            // after decompression so that releasing it again is free.
+            constexpr bool compress()
+            {
+                if (!compressible_ || text_.empty())
+                {
+                    return false;
+                }
+
+                if (compressed_.empty())
+                {
+                    auto const bytes{std::as_bytes(std::span{text_})};
+                    if (bytes.size() < min_compressed_bytes)
+                    {
+                        compressible_ = false;
+                        return false;
+                    }
+
+                    compressed_.resize(buf::compress_bound(bytes.size()));
+                    compressed_.resize(buf::compress(bytes, compressed_));
+                    if (compressed_.size() >= bytes.size())
+                    {
+                        byte_container{compressed_.get_allocator()}.swap(
+                            compressed_);
+                        compressible_ = false;
+                        return false;
+                    }
+                    compressed_.shrink_to_fit();
+                }
+
+                text_type{text_.get_allocator()}.swap(text_);
+                return true;
+            }
+
+            // Number of line terminators ending in [first, last) range. Line
+            // feed of a CRLF pair is the end of the terminator, carriage return
+            // at the end of the buffer is always counted as a terminator.
+            [[nodiscard]] constexpr size_type newlines(size_type first,
+                size_type last) const noexcept
+            {
+                return static_cast<size_type>(
+                    std::distance(find_newline(first), find_newline(last)));
+            }
+
+            // Position of the last character of the n-th line terminator
+            // ending at or after first
+            [[nodiscard]] constexpr size_type newline(size_type first,
+                size_type n) const noexcept
+            {
+                return *std::next(find_newline(first),
+                    static_cast<std::ptrdiff_t>(n));
+            }
+
+            // Styles of line terminators in [first, last) range, a line feed
+            // at the start and a carriage return at the end of the range are
+            // not classified as their style depends on the surrounding text
+            [[nodiscard]] constexpr line_ending_counts line_endings(
+                size_type first,
+                size_type last) const noexcept
+            {
+                if (first == 0 && last == size())
+                {
+                    return line_endings_;
+                }
+
+                line_ending_counts rv{};
+                for (auto it{find_newline(first)}; it != find_newline(last);
+                     ++it)
+                {
+                    rv += classify(it, first, last);
+                }
+                return rv;
+            }
+
+            // Line feeds and carriage returns are found in the line index,
+            // so compressed content isn't decompressed. Content which isn't
+            // indexed has neither.
+            [[nodiscard]] constexpr bool is_line_feed(
+                size_type position) const noexcept
+            {
+                auto const it{find_newline(position)};
+                return it != newlines_.cend() && *it == position &&
+                    style(it) != line_ending::cr;
+            }
+
+            [[nodiscard]] constexpr bool is_carriage_return(
+                size_type position) const noexcept
+            {
+                auto const it{find_newline(position)};
+                if (it == newlines_.cend())
+                {
+                    return false;
+                }
+
+                // Carriage return of a CRLF pair precedes the indexed LF
+                auto const s{style(it)};
+                return (*it == position && s == line_ending::cr) ||
+                    (*it == position + 1 && s == line_ending::crlf);
+            }
+
+            [[nodiscard]] constexpr size_type code_points(size_type first,
+                size_type last) const noexcept
+            {
+                return code_points_before(last) - code_points_before(first);
+            }
+
+            [[nodiscard]] constexpr size_type columns(size_type first,
+                size_type last) const noexcept
+            {
+                return columns_before(last) - columns_before(first);
+            }
+
+            // Position of the code unit which makes the number of code points
+            // in [first, position] larger than count
+            [[nodiscard]] constexpr size_type find_code_point(size_type first,
+                size_type count) const noexcept
+            {
+                return find(code_points_,
+                    code_points_before(first) + count,
+                    [this](size_type position) noexcept
+                    {
+                        return static_cast<size_type>(
+                            is_code_point_start(text()[position]));
+                    });
+            }
+
+            // Position of the code unit which makes the number of columns in
+            // [first, position] larger than count
+            [[nodiscard]] constexpr size_type find_column(size_type first,
+                size_type count) const noexcept
+            {
+                return find(columns_,
+                    columns_before(first) + count,
+                    [units = text()](size_type position) noexcept
+                    {
+                        return count_columns(units, position, position + 1);
+                    });
+            }
+
+        public: // Operators
+            constexpr buffer& operator=(buffer const&) = default;
+
+            constexpr buffer& operator=(buffer&&) noexcept = default;
+
+            constexpr CharT const& operator[](size_type position) const noexcept
+            {
+                return text()[position];
+            }
+
+            constexpr CharT& operator[](size_type position) noexcept
+            {
+                if (borrowed_.empty())
+                {
+                    // Content can be modified, compressed copy is outdated
+                    load();
+                    if (!compressed_.empty())
+                    {
+                        byte_container{compressed_.get_allocator()}.swap(
+                            compressed_);
+                    }
+                    return text_[position];
+                }
+                return borrowed_[position];
+            }
+
+        private: // Helpers
+            constexpr void load() const noexcept
+            {
+                if (text_.size() != size_) [[unlikely]]
+                {
+                    decompress();
+                }
+
+                // Only the first access after a tick writes
+                if (tracked_ && !referenced_) [[unlikely]]
+                {
+                    referenced_ = true;
+                }
+            }
+
+            constexpr void decompress() const noexcept
+            {
+                text_.resize(size_);
+                buf::decompress(compressed_,
+                    std::as_writable_bytes(std::span{text_}));
+            }
+
+            constexpr void index()
+            {
+                auto const units{text()};
+                auto const find = [units](size_type first, CharT value)
+                { return find_code_unit<CharT, Traits>(units, first, value); };
+
+                // CR is a line terminator unless it is followed by LF, both
+                // positions are the size of the content when there are no
+                // more of them
+                auto line_feed{find(0, CharT{'\n'})};
+                auto carriage_return{find(0, CharT{'\r'})};
+                while (line_feed != carriage_return)
+                {
+                    auto& next{line_feed < carriage_return ? line_feed
+                                                           : carriage_return};
+                    if (next == line_feed || next + 1 != line_feed ||
+                        line_feed == units.size())
+                    {
+                        newlines_.push_back(next);
+                        if (next == carriage_return)
+                        {
+                            styles_.push_back(line_ending::cr);
+                        }
+                        else
+                        {
+                            styles_.push_back(next != 0 &&
+                                    units[next - 1] == CharT{'\r'}
+                                ? line_ending::crlf
+                                : line_ending::lf);
+                        }
+                        line_endings_ += classify(std::prev(newlines_.cend()),
+                            0,
+                            units.size());
+                    }
+                    next = find(next + 1, units[next]);
+                }
+
+                ascii_ = is_ascii(units);
+                if (ascii_) // Every code unit is a code point and a column
+                {
+                    return;
+                }
+
+                auto const checkpoints{units.size() / checkpoint_interval + 1};
+                code_points_.reserve(checkpoints);
+                columns_.reserve(checkpoints);
+
+                size_type code_points{};
+                size_type columns{};
+                for (size_type i{}; i != checkpoints; ++i)
+                {
+                    code_points_.push_back(code_points);
+                    columns_.push_back(columns);
+
+                    auto const first{i * checkpoint_interval};
+                    auto const last{
+                        std::min(first + checkpoint_interval, units.size())};
+                    code_points +=
+                        count_code_points(units.subspan(first, last - first));
+                    columns += count_columns(units, first, last);
+                }
+            }
+
+            [[nodiscard]] constexpr line_ending_counts classify(
+                index_container::const_iterator newline,
+                size_type first,
+                size_type last) const noexcept
+            {
+                switch (style(newline))
+                {
+                case line_ending::lf:
+                    return *newline == first ? line_ending_counts{}
+                                             : lf_terminator;
+                case line_ending::crlf:
+                    return *newline == first ? line_ending_counts{}
+                                             : crlf_terminator;
+                default:
+                    return *newline + 1 == last ? line_ending_counts{}
+                                                : cr_terminator;
+                }
+            }
+
+            [[nodiscard]] constexpr line_ending style(
+                index_container::const_iterator newline) const noexcept
+            {
+                return styles_[static_cast<size_type>(
+                    std::distance(newlines_.cbegin(), newline))];
+            }
+
+            [[nodiscard]] constexpr index_container::const_iterator
+            find_newline(size_type position) const noexcept
+            {
+                return std::ranges::lower_bound(newlines_, position);
+            }
+
+            [[nodiscard]] constexpr size_type code_points_before(
+                size_type position) const noexcept
+            {
+                if (ascii_)
+                {
+                    return position;
+                }
+
+                auto const checkpoint{position / checkpoint_interval};
+                auto const first{checkpoint * checkpoint_interval};
+                return code_points_[checkpoint] +
+                    count_code_points(text().subspan(first, position - first));
+            }
+
+            [[nodiscard]] constexpr size_type columns_before(
+                size_type position) const noexcept
+            {
+                if (ascii_)
+                {
+                    return position;
+                }
+
+                auto const checkpoint{position / checkpoint_interval};
+                auto const first{checkpoint * checkpoint_interval};
+                return columns_[checkpoint] +
+                    count_columns(text(), first, position);
+            }
+
+            template<typename Metric>
+            [[nodiscard]] constexpr size_type find(
+                index_container const& checkpoints,
+                size_type target,
+                Metric metric) const noexcept
+            {
+                if (ascii_)
+                {
+                    return std::min(target, size());
+                }
+
+                auto const checkpoint{static_cast<size_type>(
+                    std::distance(checkpoints.cbegin(),
+                        std::ranges::upper_bound(checkpoints, target))) -
+                    1};
+
+                auto value{checkpoints[checkpoint]};
+                for (auto position{checkpoint * checkpoint_interval};
+                     position < size();
+                     ++position)
+                {
+                    value += metric(position);
+                    if (value > target)
+                    {
+                        return position;
+                    }
+                }
+
+                return size();
+            }
+
+        private: // Data
+            // Empty while only compressed content is held
+            mutable text_type text_;
+            size_type size_{};
+            byte_container compressed_;
+            std::span<CharT> borrowed_;
+            index_container newlines_;
+            // Style of each line terminator, LF of a CRLF pair is crlf even
+            // when the CR and LF end up in different pieces
+            style_container styles_;
+            index_container code_points_;
+            index_container columns_;
+            line_ending_counts line_endings_{};
+            bool ascii_{true};
+            bool indexed_{true};
+            bool compressible_{true};
+            // Set by trim(), without a resident limit content isn't
+            // modified by const access
+            bool tracked_{};
+            mutable bool referenced_{true};
+            std::uint64_t last_use_{};
+        };
 
         struct node final
         {
             std::size_t buffer_index{};
             std::size_t start_offset{};
             std::size_t length{};
+            std::size_t newlines{};
+            std::size_t code_points{};
+            std::size_t columns{};
+            // Line terminators which can pair with a neighbouring node,
+            // newlines counts the carriage return at the end only when it
+            // is a line terminator within its buffer
+            bool starts_with_line_feed{};
+            bool ends_with_carriage_return{};
+            bool counts_carriage_return{};
+        };
+
+        // Sums of all nodes before a node
+        struct node_position final
+        {
+            std::size_t offset{};
+            std::size_t newlines{};
+            std::size_t code_points{};
+            std::size_t columns{};
+        };
+
+        struct insertion_site final
+        {
+            std::size_t position{};
+            std::size_t start_offset{};
+            std::size_t length{};
+        };
+
+        template<typename T>
+        concept insertion = requires(T const& value) {
+            {
+                std::get<0>(value)
+            } -> std::convertible_to<std::size_t>;
+            requires std::ranges::forward_range<
+                std::remove_cvref_t<decltype(std::get<1>(value))>>;
         };
     } // namespace detail
 
+    // Content of a text buffer is a sequence of pieces, each one a range of
+    // one of its buffers
+    struct text_piece final
+    {
+        std::size_t buffer_index{};
+        std::size_t start_offset{};
+        std::size_t length{};
+
+        friend constexpr bool operator==(text_piece const&,
+            text_piece const&) noexcept = default;
+    };
+
+    struct text_position final
+    {
+        std::size_t line{};
+        std::size_t code_point{};
+        std::size_t column{};
+
+        friend constexpr bool operator==(text_position const&,
+            text_position const&) noexcept = default;
+    };
+
     template<typename CharT, typename Traits, typename Allocator>
     class basic_text_buffer_const_iterator;
 
@@ -54,6 +775,8 @@ namespace afv::buf
     private:
         using buffer = detail::buffer<CharT, Traits, Allocator>;
 
+        using text_type = buffer::text_type;
+
         using buffer_allocator =
             std::allocator_traits<Allocator>::template rebind_alloc<buffer>;
 
@@ -64,34 +787,46 @@ namespace afv::buf
 
         using node_container = std::vector<detail::node, node_allocator>;
 
+        using position_allocator = std::allocator_traits<
+            Allocator>::template rebind_alloc<detail::node_position>;
+
+        using position_container =
+            std::vector<detail::node_position, position_allocator>;
+
     public: // Construction
         constexpr basic_text_buffer() noexcept(
             std::is_nothrow_constructible_v<Allocator> &&
             std::is_nothrow_constructible_v<buffer_container, Allocator> &&
-            std::is_nothrow_constructible_v<node_container, Allocator>)
+            std::is_nothrow_constructible_v<node_container, Allocator> &&
+            std::is_nothrow_constructible_v<position_container, Allocator>)
             : buffers_{Allocator{}}
             , nodes_{Allocator{}}
+            , positions_{Allocator{}}
         {
         }
 
         constexpr explicit basic_text_buffer(Allocator const& alloc) noexcept(
             std::is_nothrow_constructible_v<buffer_container, Allocator> &&
-            std::is_nothrow_constructible_v<node_container, Allocator>)
+            std::is_nothrow_constructible_v<node_container, Allocator> &&
+            std::is_nothrow_constructible_v<position_container, Allocator>)
             : buffers_{alloc}
             , nodes_{alloc}
+            , positions_{alloc}
         {
         }
 
         constexpr basic_text_buffer(basic_text_buffer const&) noexcept(
             std::is_nothrow_copy_constructible_v<buffer_container> &&
-            std::is_nothrow_copy_constructible_v<node_container>) = default;
+            std::is_nothrow_copy_constructible_v<node_container> &&
+            std::is_nothrow_copy_constructible_v<position_container>) = default;
 
         // clang-format off
         // NOLINTBEGIN(cppcoreguidelines-noexcept-move-operations, performance-noexcept-move-constructor)
         // clang-format on
         constexpr basic_text_buffer(basic_text_buffer&&) noexcept(
             std::is_nothrow_move_constructible_v<buffer_container> &&
-            std::is_nothrow_move_constructible_v<node_container>) = default;
+            std::is_nothrow_move_constructible_v<node_container> &&
+            std::is_nothrow_move_constructible_v<position_container>) = default;
         // clang-format off
         // NOLINTEND(cppcoreguidelines-noexcept-move-operations, performance-noexcept-move-constructor)
         // clang-format on
@@ -100,16 +835,64 @@ namespace afv::buf
         ~basic_text_buffer() = default;
 
     public: // Interface
+        [[nodiscard]] constexpr allocator_type get_allocator() const noexcept
+        {
+            return allocator_type{nodes_.get_allocator()};
+        }
+
         [[nodiscard]] constexpr bool empty() const noexcept
         {
             return nodes_.empty();
         }
 
+        [[nodiscard]] constexpr size_type size() const noexcept
+        {
+            return totals().offset;
+        }
+
         [[nodiscard]] constexpr size_type lines() const noexcept;
 
+        // Style of line terminators in the content
+        [[nodiscard]] constexpr line_ending line_endings() const noexcept;
+
+        // Line terminator matching the style of the content, LF if the
+        // content has no line terminators or mixes different styles
+        [[nodiscard]] constexpr std::basic_string_view<CharT, Traits>
+        line_terminator() const noexcept;
+
+        // Content of the line without the line terminator
         [[nodiscard]] constexpr std::ranges::subrange<const_iterator> line(
             size_type line) const;
 
+        // Content of the line displayed in [first_column, last_column) range,
+        // a character occupying multiple columns belongs to the range which
+        // contains its last column
+        [[nodiscard]] constexpr std::ranges::subrange<const_iterator> line(
+            size_type line,
+            size_type first_column,
+            size_type last_column) const;
+
+        // Offset of the first character of the line
+        [[nodiscard]] constexpr size_type line_offset(
+            size_type line) const noexcept;
+
+        // Number of terminal columns used by the line
+        [[nodiscard]] constexpr size_type line_width(
+            size_type line) const noexcept;
+
+        [[nodiscard]] constexpr text_position position(
+            size_type offset) const noexcept;
+
+        // Offset of the character displayed at the column of the line or the
+        // offset of the line end for columns past the end of the line
+        [[nodiscard]] constexpr size_type column_offset(size_type line,
+            size_type column) const noexcept;
+
+        // Offset of the n-th code point of the line or the offset of the line
+        // end for code points past the end of the line
+        [[nodiscard]] constexpr size_type code_point_offset(size_type line,
+            size_type code_point) const noexcept;
+
         template<std::ranges::forward_range Range>
         constexpr void insert(size_type position, Range const& range);
 
@@ -117,6 +900,77 @@ namespace afv::buf
             std::sentinel_for<Iterator> Sentinel>
         constexpr void insert(size_type position, Iterator begin, Sentinel end);
 
+        // Inserts content owned by the caller without copying it. Content must
+        // outlive the text buffer, it is modified in place through mutable
+        // iterators.
+        constexpr void insert_borrowed(size_type position,
+            std::span<CharT> content,
+            indexing mode = indexing::full);
+
+        // Applies all (position, text) insertions in a single pass. Positions
+        // refer to the content before the batch, insertions at the same
+        // position keep their relative order.
+        template<std::ranges::forward_range Insertions>
+        requires detail::insertion<std::ranges::range_value_t<Insertions>>
+        constexpr void insert_batch(Insertions const& insertions);
+
+        // Pieces of the content in order. Add buffers only grow, so a piece
+        // of a copy refers to the same content as the piece of the original
+        // with equal buffer index and start offset.
+        [[nodiscard]] constexpr std::ranges::sized_range auto
+        pieces() const noexcept
+        {
+            return nodes_ |
+                std::views::transform(
+                    [](detail::node const& node) noexcept
+                    {
+                        return text_piece{.buffer_index = node.buffer_index,
+                            .start_offset = node.start_offset,
+                            .length = node.length};
+                    });
+        }
+
+        // Calls the function with contiguous spans of content in
+        // [offset, offset + count) range, in order
+        template<std::invocable<std::span<CharT const>> Function>
+        constexpr void for_each_span(size_type offset,
+            size_type count,
+            Function function) const;
+
+        // Maximum number of code units of inserted content kept uncompressed
+        // after trim(), borrowed content isn't counted. Unlimited by default.
+        // Once trim() ran with a limit, const access decompresses content
+        // and records its use, so it is no longer safe from multiple
+        // threads.
+        [[nodiscard]] constexpr size_type resident_limit() const noexcept
+        {
+            return resident_limit_;
+        }
+
+        constexpr void set_resident_limit(size_type limit) noexcept
+        {
+            resident_limit_ = limit;
+        }
+
+        // Number of code units of inserted content held uncompressed
+        [[nodiscard]] constexpr size_type resident_size() const noexcept
+        {
+            size_type rv{};
+            for (buffer const& b : buffers_)
+            {
+                rv += b.resident_size();
+            }
+            return rv;
+        }
+
+        // Compresses inserted content which wasn't accessed for the longest
+        // time until the resident limit is met. Compressed content is
+        // decompressed when it is accessed again, so const member functions
+        // modify the buffer, can't be called concurrently and terminate when
+        // the memory for decompressed content can't be allocated. Invalidates
+        // references to the content.
+        constexpr void trim();
+
     public: // Iterators
         [[nodiscard]] constexpr iterator begin() noexcept
         {
@@ -152,22 +1006,72 @@ namespace afv::buf
         constexpr basic_text_buffer&
         operator=(basic_text_buffer const&) noexcept(
             std::is_nothrow_copy_assignable_v<buffer_container> &&
-            std::is_nothrow_copy_assignable_v<node_container>) = default;
+            std::is_nothrow_copy_assignable_v<node_container> &&
+            std::is_nothrow_copy_assignable_v<position_container>) = default;
 
         // clang-format off
         // NOLINTBEGIN(cppcoreguidelines-noexcept-move-operations, performance-noexcept-move-constructor)
         // clang-format on
         constexpr basic_text_buffer& operator=(basic_text_buffer&&) noexcept(
             std::is_nothrow_move_assignable_v<buffer_container> &&
-            std::is_nothrow_move_assignable_v<node_container>) = default;
+            std::is_nothrow_move_assignable_v<node_container> &&
+            std::is_nothrow_move_assignable_v<position_container>) = default;
         // clang-format off
         // NOLINTEND(cppcoreguidelines-noexcept-move-operations, performance-noexcept-move-constructor)
         // clang-format on
 
+    private: // Helpers
+        [[nodiscard]] constexpr detail::node make_node(size_type buffer_index,
+            size_type start_offset,
+            size_type length) const noexcept;
+
+        [[nodiscard]] constexpr detail::node_position totals() const noexcept
+        {
+            return positions_.empty() ? detail::node_position{}
+                                      : positions_.back();
+        }
+
+        // Index of the first node which ends after the value of the member
+        [[nodiscard]] constexpr size_type find_node(
+            std::size_t detail::node_position::*member,
+            size_type value) const noexcept;
+
+        // Sums of all characters before the offset
+        [[nodiscard]] constexpr detail::node_position prefix(
+            size_type offset) const noexcept;
+
+        [[nodiscard]] constexpr size_type line_end(
+            size_type line) const noexcept;
+
+        template<typename Find>
+        [[nodiscard]] constexpr size_type find_in_line(size_type line,
+            std::size_t detail::node_position::*member,
+            size_type count,
+            Find find) const noexcept;
+
+        [[nodiscard]] constexpr const_iterator iterator_at(
+            size_type offset) const noexcept;
+
+        // Inserts the whole last buffer at the position
+        constexpr void insert_buffer(size_type position);
+
+        // Recalculates positions of nodes starting from the node before the
+        // given node
+        constexpr void reindex(size_type first_node);
+
+        // Line terminator formed by the character before the offset and the
+        // character at the offset, carriage return at the end of the content
+        // is still undecided
+        [[nodiscard]] constexpr detail::line_ending_counts terminator_at(
+            size_type offset) const noexcept;
+
     private: // Data
         buffer_container buffers_;
         node_container nodes_;
-        size_type lines_{};
+        position_container positions_;
+        detail::line_ending_counts line_endings_{};
+        size_type resident_limit_{std::numeric_limits<size_type>::max()};
+        std::uint64_t clock_{};
     };
 
     template<typename CharT, typename Traits, typename Allocator>
@@ -179,12 +1083,55 @@ namespace afv::buf
             return 0;
         }
 
-        if (*std::prev(cend()) != '\n')
+        auto const& node{nodes_.back()};
+        auto const& b{buffers_[node.buffer_index]};
+        if (auto const last{node.start_offset + node.length - 1};
+            !b.is_line_feed(last) && !b.is_carriage_return(last))
         {
-            return lines_ + 1;
+            return totals().newlines + 1;
         }
 
-        return lines_;
+        return totals().newlines;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr line_ending
+    basic_text_buffer<CharT, Traits, Allocator>::line_endings() const noexcept
+    {
+        auto const& [lf, crlf, cr]{line_endings_};
+        if ((lf != 0) + (crlf != 0) + (cr != 0) > 1)
+        {
+            return line_ending::mixed;
+        }
+
+        if (lf != 0)
+        {
+            return line_ending::lf;
+        }
+
+        if (crlf != 0)
+        {
+            return line_ending::crlf;
+        }
+
+        return cr != 0 ? line_ending::cr : line_ending::none;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr std::basic_string_view<CharT, Traits>
+    basic_text_buffer<CharT, Traits, Allocator>::line_terminator()
+        const noexcept
+    {
+        auto const& crlf{detail::crlf<CharT>};
+        switch (line_endings())
+        {
+        case line_ending::crlf:
+            return {crlf.data(), 2};
+        case line_ending::cr:
+            return {crlf.data(), 1};
+        default:
+            return {std::next(crlf.data()), 1};
+        }
     }
 
     template<typename CharT, typename Traits, typename Allocator>
@@ -193,17 +1140,102 @@ namespace afv::buf
     basic_text_buffer<CharT, Traits, Allocator>::line(
         basic_text_buffer::size_type line) const
     {
-        auto begin{cbegin()};
-        auto end{cend()};
-        for (; begin != end && line > 0; ++begin)
+        AFV_TRACE_SCOPE("buf::line");
+        return std::ranges::subrange(iterator_at(line_offset(line)),
+            iterator_at(line_end(line)));
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr std::ranges::subrange<
+        basic_text_buffer_const_iterator<CharT, Traits, Allocator>>
+    basic_text_buffer<CharT, Traits, Allocator>::line(
+        basic_text_buffer::size_type line,
+        basic_text_buffer::size_type first_column,
+        basic_text_buffer::size_type last_column) const
+    {
+        AFV_TRACE_SCOPE("buf::line");
+        return std::ranges::subrange(
+            iterator_at(column_offset(line, first_column)),
+            iterator_at(column_offset(line, last_column)));
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::line_offset(
+        basic_text_buffer::size_type line) const noexcept
+    {
+        if (line == 0)
         {
-            if (*begin == '\n')
-            {
-                --line;
-            }
+            return 0;
+        }
+
+        auto const all{totals()};
+        if (line > all.newlines)
+        {
+            return all.offset;
         }
-        return std::ranges::subrange(begin,
-            std::ranges::find(begin, end, '\n'));
+
+        // Line starts after the line terminator of the previous line
+        auto const node_index{
+            find_node(&detail::node_position::newlines, line - 1)};
+        auto const& node{nodes_[node_index]};
+        auto const& position{positions_[node_index]};
+        auto const n{line - 1 - position.newlines};
+        if (n == node.newlines) // Carriage return at the end of the node
+        {
+            return position.offset + node.length;
+        }
+
+        auto const newline{
+            buffers_[node.buffer_index].newline(node.start_offset, n)};
+        return position.offset + (newline - node.start_offset) + 1;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::line_width(
+        basic_text_buffer::size_type line) const noexcept
+    {
+        return prefix(line_end(line)).columns -
+            prefix(line_offset(line)).columns;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr text_position
+    basic_text_buffer<CharT, Traits, Allocator>::position(
+        basic_text_buffer::size_type offset) const noexcept
+    {
+        auto const at{prefix(offset)};
+        auto const line_start{prefix(line_offset(at.newlines))};
+        return {.line = at.newlines,
+            .code_point = at.code_points - line_start.code_points,
+            .column = at.columns - line_start.columns};
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::column_offset(
+        basic_text_buffer::size_type line,
+        basic_text_buffer::size_type column) const noexcept
+    {
+        return find_in_line(line,
+            &detail::node_position::columns,
+            column,
+            [](buffer const& b, size_type first, size_type count) noexcept
+            { return b.find_column(first, count); });
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::code_point_offset(
+        basic_text_buffer::size_type line,
+        basic_text_buffer::size_type code_point) const noexcept
+    {
+        return find_in_line(line,
+            &detail::node_position::code_points,
+            code_point,
+            [](buffer const& b, size_type first, size_type count) noexcept
+            { return b.find_code_point(first, count); });
     }
 
     template<typename CharT, typename Traits, typename Allocator>
@@ -223,46 +1255,495 @@ namespace afv::buf
         Iterator begin,
         Sentinel end)
     {
-        size_type split_at{};
-        auto const node_it{std::ranges::find_if(nodes_,
-            [running_sum = size_type{}, position, &split_at](
-                detail::node const& n) mutable noexcept
+        AFV_TRACE_SCOPE("buf::insert");
+        if (begin == end)
+        {
+            return;
+        }
+
+        text_type text{get_allocator()};
+        if constexpr (std::same_as<Iterator, Sentinel>)
+        {
+            text.assign(begin, end);
+        }
+        else
+        {
+            std::ranges::copy(begin, end, std::back_inserter(text));
+        }
+
+        buffers_.emplace_back(std::move(text));
+        insert_buffer(position);
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr void basic_text_buffer<CharT, Traits, Allocator>::insert_borrowed(
+        basic_text_buffer::size_type position,
+        std::span<CharT> content,
+        indexing mode)
+    {
+        AFV_TRACE_SCOPE("buf::insert_borrowed");
+        if (content.empty())
+        {
+            return;
+        }
+
+        buffers_.emplace_back(content, mode);
+        insert_buffer(position);
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr void basic_text_buffer<CharT, Traits, Allocator>::insert_buffer(
+        basic_text_buffer::size_type position)
+    {
+        auto const start{std::min(position, size())};
+        auto const node_index{
+            find_node(&detail::node_position::offset, position)};
+        auto const& added{buffers_.back()};
+        auto const new_node{make_node(buffers_.size() - 1, 0, added.size())};
+        auto const replaced{terminator_at(start)};
+        if (node_index == nodes_.size()) // Appending to end
+        {
+            nodes_.push_back(new_node);
+        }
+        else
+        {
+            auto const node_it{std::next(nodes_.begin(),
+                static_cast<difference_type>(node_index))};
+            auto const split_at{position - positions_[node_index].offset};
+            if (split_at == 0) // Add buffer before the current one
+            {
+                nodes_.insert(node_it, new_node);
+            }
+            else // Split the existing node into two and new node in the middle
+            {
+                auto const new_split{make_node(node_it->buffer_index,
+                    node_it->start_offset + split_at,
+                    node_it->length - split_at)};
+
+                *node_it = make_node(node_it->buffer_index,
+                    node_it->start_offset,
+                    split_at);
+                nodes_.insert(std::next(node_it), {new_node, new_split});
+            }
+        }
+
+        reindex(node_index);
+        line_endings_ += added.line_endings(0, added.size());
+        line_endings_ += terminator_at(start);
+        line_endings_ += terminator_at(start + new_node.length);
+        line_endings_ -= replaced;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    template<std::ranges::forward_range Insertions>
+    requires detail::insertion<std::ranges::range_value_t<Insertions>>
+    constexpr void basic_text_buffer<CharT, Traits, Allocator>::insert_batch(
+        Insertions const& insertions)
+    {
+        AFV_TRACE_SCOPE("buf::insert_batch");
+        using site_allocator = std::allocator_traits<
+            Allocator>::template rebind_alloc<detail::insertion_site>;
+
+        // All inserted text goes to a single buffer
+        text_type text{get_allocator()};
+        std::vector<detail::insertion_site, site_allocator> sites{
+            site_allocator{nodes_.get_allocator()}};
+        for (auto const& insertion : insertions)
+        {
+            auto const start_offset{text.size()};
+            std::ranges::copy(std::get<1>(insertion),
+                std::back_inserter(text));
+            if (text.size() != start_offset)
             {
-                if (position >= running_sum &&
-                    position < running_sum + n.length)
+                sites.push_back(
+                    {.position = static_cast<size_type>(std::get<0>(insertion)),
+                        .start_offset = start_offset,
+                        .length = text.size() - start_offset});
+            }
+        }
+
+        if (sites.empty())
+        {
+            return;
+        }
+
+        std::ranges::stable_sort(sites, {}, &detail::insertion_site::position);
+
+        // Terminators at insertion sites are separated by the inserted text
+        auto const old_size{size()};
+        auto const same_position =
+            [old_size](detail::insertion_site const& lhs,
+                detail::insertion_site const& rhs) noexcept
+        {
+            return std::min(lhs.position, old_size) ==
+                std::min(rhs.position, old_size);
+        };
+        detail::line_ending_counts replaced{};
+        for (auto it{sites.cbegin()}; it != sites.cend(); ++it)
+        {
+            if (it == sites.cbegin() || !same_position(*std::prev(it), *it))
+            {
+                replaced += terminator_at(std::min(it->position, old_size));
+            }
+        }
+
+        auto const buffer_index{buffers_.size()};
+        buffers_.emplace_back(std::move(text));
+
+        auto const first_node{find_node(&detail::node_position::offset,
+            sites.front().position)};
+        node_container merged{nodes_.get_allocator()};
+        merged.reserve(nodes_.size() + 2 * sites.size());
+
+        auto const emplace_site = [this, &merged, buffer_index](
+                                      detail::insertion_site const& site)
+        {
+            // Insertions at the same position are contiguous in the buffer
+            if (!merged.empty() && merged.back().buffer_index == buffer_index &&
+                merged.back().start_offset + merged.back().length ==
+                    site.start_offset)
+            {
+                merged.back() = make_node(buffer_index,
+                    merged.back().start_offset,
+                    merged.back().length + site.length);
+                return;
+            }
+            merged.push_back(
+                make_node(buffer_index, site.start_offset, site.length));
+        };
+
+        auto site_it{sites.cbegin()};
+        size_type running_sum{};
+        for (detail::node const& n : nodes_)
+        {
+            size_type split_at{};
+            for (; site_it != sites.cend() &&
+                 site_it->position < running_sum + n.length;
+                 ++site_it)
+            {
+                auto const local_offset{site_it->position - running_sum};
+                if (local_offset != split_at)
                 {
-                    split_at = position - running_sum;
-                    return true;
+                    merged.push_back(make_node(n.buffer_index,
+                        n.start_offset + split_at,
+                        local_offset - split_at));
+                    split_at = local_offset;
                 }
-                running_sum += n.length;
-                return false;
-            })};
+                emplace_site(*site_it);
+            }
+
+            if (split_at == 0)
+            {
+                merged.push_back(n);
+            }
+            else
+            {
+                merged.push_back(make_node(n.buffer_index,
+                    n.start_offset + split_at,
+                    n.length - split_at));
+            }
+            running_sum += n.length;
+        }
+
+        // Appending to end
+        std::ranges::for_each(site_it, sites.cend(), emplace_site);
 
-        auto const& text{buffers_.emplace_back(begin, end)};
-        lines_ += static_cast<size_type>(std::ranges::count(text, '\n'));
-        if (node_it == nodes_.cend()) // Appending to end
+        nodes_ = std::move(merged);
+        reindex(first_node);
+
+        auto const& added{buffers_[buffer_index]};
+        size_type inserted_before{};
+        for (auto it{sites.cbegin()}; it != sites.cend(); ++it)
+        {
+            line_endings_ += added.line_endings(it->start_offset,
+                it->start_offset + it->length);
+
+            auto const start{
+                std::min(it->position, old_size) + inserted_before};
+            line_endings_ += terminator_at(start);
+            if (auto const next{std::next(it)};
+                next == sites.cend() || !same_position(*it, *next))
+            {
+                line_endings_ += terminator_at(start + it->length);
+            }
+            inserted_before += it->length;
+        }
+        line_endings_ -= replaced;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    template<std::invocable<std::span<CharT const>> Function>
+    constexpr void basic_text_buffer<CharT, Traits, Allocator>::for_each_span(
+        basic_text_buffer::size_type offset,
+        basic_text_buffer::size_type count,
+        Function function) const
+    {
+        auto const first{std::min(offset, size())};
+        auto const last{first + std::min(count, size() - first)};
+        for (auto i{find_node(&detail::node_position::offset, first)};
+             i != nodes_.size() && positions_[i].offset < last;
+             ++i)
+        {
+            auto const& node{nodes_[i]};
+            auto const& position{positions_[i]};
+            auto const span_first{std::max(first, position.offset)};
+            auto const span_last{std::min(last, positions_[i + 1].offset)};
+            function(buffers_[node.buffer_index].text().subspan(
+                node.start_offset + (span_first - position.offset),
+                span_last - span_first));
+        }
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr void basic_text_buffer<CharT, Traits, Allocator>::trim()
+    {
+        using index_allocator =
+            std::allocator_traits<Allocator>::template rebind_alloc<size_type>;
+
+        if (resident_limit_ == std::numeric_limits<size_type>::max())
         {
-            nodes_.emplace_back(buffers_.size() - 1, 0, text.size());
             return;
         }
 
-        if (split_at == 0) // Add buffer before the current one
+        // Buffers accessed since the previous trim are the most recent
+        ++clock_;
+        size_type resident{};
+        std::vector<size_type, index_allocator> candidates{
+            index_allocator{nodes_.get_allocator()}};
+        for (size_type i{}; i != buffers_.size(); ++i)
+        {
+            buffers_[i].tick(clock_);
+            if (auto const size{buffers_[i].resident_size()}; size != 0)
+            {
+                resident += size;
+                candidates.push_back(i);
+            }
+        }
+
+        if (resident <= resident_limit_)
         {
-            nodes_.insert(node_it,
-                detail::node{.buffer_index = buffers_.size() - 1,
-                    .start_offset = 0,
-                    .length = text.size()});
             return;
         }
 
-        // Split the existing node into two and new node in the middle
-        detail::node const new_node{buffers_.size() - 1, 0, text.size()};
-        detail::node const new_split{node_it->buffer_index,
-            split_at,
-            node_it->length - split_at};
+        std::ranges::stable_sort(candidates,
+            {},
+            [this](size_type i) { return buffers_[i].last_use(); });
+        for (size_type const i : candidates)
+        {
+            auto const size{buffers_[i].resident_size()};
+            if (buffers_[i].compress())
+            {
+                resident -= size;
+                if (resident <= resident_limit_)
+                {
+                    return;
+                }
+            }
+        }
+    }
 
-        node_it->length = split_at;
-        nodes_.insert(std::next(node_it), {new_node, new_split});
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr detail::node
+    basic_text_buffer<CharT, Traits, Allocator>::make_node(
+        basic_text_buffer::size_type buffer_index,
+        basic_text_buffer::size_type start_offset,
+        basic_text_buffer::size_type length) const noexcept
+    {
+        auto const& b{buffers_[buffer_index]};
+        auto const last{start_offset + length};
+        bool const carriage_return{b.is_carriage_return(last - 1)};
+        return {.buffer_index = buffer_index,
+            .start_offset = start_offset,
+            .length = length,
+            .newlines = b.newlines(start_offset, last),
+            .code_points = b.code_points(start_offset, last),
+            .columns = b.columns(start_offset, last),
+            .starts_with_line_feed = b.is_line_feed(start_offset),
+            .ends_with_carriage_return = carriage_return,
+            .counts_carriage_return =
+                carriage_return && b.newlines(last - 1, last) != 0};
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::find_node(
+        std::size_t detail::node_position::*member,
+        basic_text_buffer::size_type value) const noexcept
+    {
+        if (nodes_.empty())
+        {
+            return 0;
+        }
+
+        auto const first{std::next(positions_.cbegin())};
+        return static_cast<size_type>(std::distance(first,
+            std::ranges::upper_bound(first,
+                positions_.cend(),
+                value,
+                std::ranges::less{},
+                member)));
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr detail::node_position
+    basic_text_buffer<CharT, Traits, Allocator>::prefix(
+        basic_text_buffer::size_type offset) const noexcept
+    {
+        auto const node_index{find_node(&detail::node_position::offset, offset)};
+        if (node_index == nodes_.size())
+        {
+            return totals();
+        }
+
+        auto const& node{nodes_[node_index]};
+        auto const& position{positions_[node_index]};
+        auto const& b{buffers_[node.buffer_index]};
+        auto const last{node.start_offset + (offset - position.offset)};
+        return {.offset = offset,
+            .newlines = position.newlines + b.newlines(node.start_offset, last),
+            .code_points =
+                position.code_points + b.code_points(node.start_offset, last),
+            .columns = position.columns + b.columns(node.start_offset, last)};
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::line_end(
+        basic_text_buffer::size_type line) const noexcept
+    {
+        if (line >= totals().newlines)
+        {
+            return totals().offset;
+        }
+
+        auto const terminator{line_offset(line + 1) - 1};
+        if (auto const it{iterator_at(terminator)};
+            terminator != 0 && *it == '\n' && *std::prev(it) == '\r')
+        {
+            return terminator - 1;
+        }
+
+        return terminator;
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    template<typename Find>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::size_type
+    basic_text_buffer<CharT, Traits, Allocator>::find_in_line(
+        basic_text_buffer::size_type line,
+        std::size_t detail::node_position::*member,
+        basic_text_buffer::size_type count,
+        Find find) const noexcept
+    {
+        auto const last{line_end(line)};
+        auto const target{prefix(line_offset(line)).*member + count};
+        auto const node_index{find_node(member, target)};
+        if (node_index == nodes_.size())
+        {
+            return last;
+        }
+
+        auto const& node{nodes_[node_index]};
+        auto const& position{positions_[node_index]};
+        auto const found{find(buffers_[node.buffer_index],
+            node.start_offset,
+            target - position.*member)};
+        return std::min(position.offset + (found - node.start_offset), last);
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr basic_text_buffer<CharT, Traits, Allocator>::const_iterator
+    basic_text_buffer<CharT, Traits, Allocator>::iterator_at(
+        basic_text_buffer::size_type offset) const noexcept
+    {
+        auto const node_index{find_node(&detail::node_position::offset, offset)};
+        if (node_index == nodes_.size())
+        {
+            return cend();
+        }
+
+        return {nodes_,
+            node_index,
+            buffers_.data(),
+            offset - positions_[node_index].offset};
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr void basic_text_buffer<CharT, Traits, Allocator>::reindex(
+        basic_text_buffer::size_type first_node)
+    {
+        positions_.resize(nodes_.size() + 1);
+        for (auto i{first_node == 0 ? 0 : first_node - 1}; i != nodes_.size();
+             ++i)
+        {
+            auto const& node{nodes_[i]};
+            auto const& position{positions_[i]};
+
+            // Carriage return at the end of a node is a line terminator only
+            // when the next node doesn't start with a line feed
+            auto newlines{position.newlines + node.newlines};
+            if (node.ends_with_carriage_return)
+            {
+                bool const terminator{i + 1 == nodes_.size() ||
+                    !nodes_[i + 1].starts_with_line_feed};
+                if (node.counts_carriage_return && !terminator)
+                {
+                    --newlines;
+                }
+                else if (!node.counts_carriage_return && terminator)
+                {
+                    ++newlines;
+                }
+            }
+
+            positions_[i + 1] = {.offset = position.offset + node.length,
+                .newlines = newlines,
+                .code_points = position.code_points + node.code_points,
+                .columns = position.columns + node.columns};
+        }
+    }
+
+    template<typename CharT, typename Traits, typename Allocator>
+    constexpr detail::line_ending_counts
+    basic_text_buffer<CharT, Traits, Allocator>::terminator_at(
+        basic_text_buffer::size_type offset) const noexcept
+    {
+        // Index of the content is checked instead of the content so that
+        // neighbours of an edit aren't decompressed
+        auto const at = [this](size_type position)
+        {
+            auto const node_index{
+                find_node(&detail::node_position::offset, position)};
+            auto const& node{nodes_[node_index]};
+            return std::pair<buffer const&, size_type>{
+                buffers_[node.buffer_index],
+                node.start_offset + (position - positions_[node_index].offset)};
+        };
+
+        bool line_feed{};
+        if (offset < size())
+        {
+            auto const [b, local]{at(offset)};
+            line_feed = b.is_line_feed(local);
+        }
+
+        bool carriage_return{};
+        if (offset != 0)
+        {
+            auto const [b, local]{at(offset - 1)};
+            carriage_return = b.is_carriage_return(local);
+        }
+
+        if (carriage_return)
+        {
+            if (line_feed)
+            {
+                return detail::crlf_terminator;
+            }
+            return offset < size() ? detail::cr_terminator
+                                   : detail::line_ending_counts{};
+        }
+        return line_feed ? detail::lf_terminator : detail::line_ending_counts{};
     }
 
     template<typename CharT, typename Traits, typename Allocator>
@@ -291,6 +1772,7 @@ namespace afv::buf
             , buffers_{buffers}
             , local_index_{buffer_index}
         {
+            load_node();
         }
 
         constexpr basic_text_buffer_const_iterator(
@@ -343,6 +1825,19 @@ namespace afv::buf
             return nodes_[node_index_];
         }
 
+        // Content of a node is decompressed and its use recorded once when
+        // the iterator enters the node, not for every element
+        constexpr void load_node() const noexcept
+        {
+            if (node_index_ < nodes_.size())
+            {
+                // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                static_cast<void>(
+                    buffers_[current_node().buffer_index].text());
+                // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            }
+        }
+
     private: // Data
         std::span<detail::node const> nodes_;
         size_t node_index_{};
@@ -361,7 +1856,7 @@ namespace afv::buf
         auto const& buffer{buffers_[node.buffer_index]};
         // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
         auto const value_index{node.start_offset + local_index_};
-        return buffer[value_index];
+        return buffer.loaded_text()[value_index];
     }
 
     template<typename CharT, typename Traits, typename Allocator>
@@ -374,6 +1869,7 @@ namespace afv::buf
         {
             ++node_index_;
             local_index_ = 0;
+            load_node();
         }
 
         return *this;
@@ -397,6 +1893,7 @@ namespace afv::buf
         if (local_index_ == 0 && node_index_ > 0)
         {
             local_index_ = nodes_[--node_index_].length;
+            load_node();
             // Intentional fallthrough
         }
 
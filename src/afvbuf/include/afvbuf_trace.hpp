@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace afv::buf
+{
+    // Scoped timers record events into a fixed size ring buffer shared by
+    // all threads without locking, the oldest events are overwritten. Timers
+    // placed with AFV_TRACE_SCOPE are compiled only when AFV_ENABLE_TRACING
+    // is defined.
+
+#if defined(AFV_ENABLE_TRACING)
+    inline constexpr bool tracing_enabled{true};
+#else
+    inline constexpr bool tracing_enabled{false};
+#endif
+
+    // Duration of a named scope, times are nanoseconds of a steady clock
+    struct trace_event final
+    {
+        char const* name{};
+        std::uint64_t start{};
+        std::uint64_t duration{};
+        std::uint32_t thread{};
+    };
+
+    namespace detail
+    {
+        // Number of events kept in the ring buffer
+        inline constexpr std::size_t trace_capacity{std::size_t{1} << 17};
+
+        [[nodiscard]] std::uint64_t trace_clock() noexcept;
+
+        void record_trace_event(char const* name,
+            std::uint64_t start,
+            std::uint64_t end) noexcept;
+    } // namespace detail
+
+    // Records the duration of its lifetime as an event, the name must
+    // outlive the trace buffer
+    class [[nodiscard]] scoped_timer final
+    {
+    public: // Construction
+        constexpr explicit scoped_timer(char const* const name) noexcept
+            : name_{name}
+        {
+            if (!std::is_constant_evaluated())
+            {
+                start_ = detail::trace_clock();
+            }
+        }
+
+        scoped_timer(scoped_timer const&) = delete;
+
+        scoped_timer(scoped_timer&&) = delete;
+
+    public: // Destruction
+        constexpr ~scoped_timer()
+        {
+            if (!std::is_constant_evaluated())
+            {
+                detail::record_trace_event(name_,
+                    start_,
+                    detail::trace_clock());
+            }
+        }
+
+    public: // Operators
+        scoped_timer& operator=(scoped_timer const&) = delete;
+
+        scoped_timer& operator=(scoped_timer&&) = delete;
+
+    private: // Data
+        char const* name_;
+        std::uint64_t start_{};
+    };
+
+    // Recorded events which weren't overwritten yet, oldest first. Events
+    // being recorded concurrently are skipped.
+    [[nodiscard]] std::vector<trace_event> trace_events();
+
+    // Writes events in the Chrome trace event format, loadable by
+    // chrome://tracing and Perfetto
+    void write_chrome_trace(std::ostream& out,
+        std::span<trace_event const> events);
+
+    // Duration under which the percentile of events with the name fall, 0
+    // if there are none
+    [[nodiscard]] std::uint64_t trace_percentile(
+        std::span<trace_event const> events,
+        std::string_view name,
+        double percentile);
+} // namespace afv::buf
+
+#if defined(AFV_ENABLE_TRACING)
+#define AFV_TRACE_CONCAT_IMPL(a, b) a##b
+#define AFV_TRACE_CONCAT(a, b) AFV_TRACE_CONCAT_IMPL(a, b)
+#define AFV_TRACE_SCOPE(name)                                                  \
+    ::afv::buf::scoped_timer const AFV_TRACE_CONCAT(afv_trace_scope_,         \
+        __LINE__){name}
+#else
+#define AFV_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
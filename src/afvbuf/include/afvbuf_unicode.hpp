@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace afv::buf
+{
+    // Code units are interpreted by their size, one byte code units are
+    // UTF-8, two byte code units are UTF-16 and four byte code units are
+    // UTF-32.
+
+    inline constexpr char32_t replacement_character{U'\uFFFD'};
+
+    struct decoded_code_point final
+    {
+        char32_t value{replacement_character};
+        std::size_t length{1};
+        bool valid{};
+    };
+
+    // Number of terminal columns used by the code point: 0 for combining and
+    // other zero width characters, 2 for East Asian wide characters and 1 for
+    // everything else
+    [[nodiscard]] std::size_t display_width(char32_t code_point) noexcept;
+
+    namespace detail
+    {
+        template<typename CharT>
+        [[nodiscard]] constexpr std::uint32_t code_unit(CharT value) noexcept
+        {
+            return static_cast<std::make_unsigned_t<CharT>>(value);
+        }
+
+        // Number of code units checked at once when skipping over ASCII text
+        inline constexpr std::size_t ascii_block_size{16};
+
+        // Longest valid sequence of code units encoding a code point
+        template<typename CharT>
+        inline constexpr std::size_t max_sequence_length{
+            sizeof(CharT) == 1 ? 4
+                : sizeof(CharT) == 2 ? 2
+                                     : 1};
+    } // namespace detail
+
+    template<typename CharT>
+    [[nodiscard]] constexpr bool is_code_point_start(CharT value) noexcept
+    {
+        auto const unit{detail::code_unit(value)};
+        if constexpr (sizeof(CharT) == 1)
+        {
+            return (unit & 0xC0U) != 0x80U;
+        }
+        else if constexpr (sizeof(CharT) == 2)
+        {
+            return unit < 0xDC00U || unit > 0xDFFFU;
+        }
+        else
+        {
+            return true;
+        }
+    }
+
+    // Decodes the code point at the start of the text. Invalid and truncated
+    // sequences decode to a single invalid code unit.
+    template<typename CharT>
+    [[nodiscard]] constexpr decoded_code_point decode(
+        std::span<CharT const> text) noexcept
+    {
+        if (text.empty())
+        {
+            return {.length = 0};
+        }
+
+        auto const lead{detail::code_unit(text[0])};
+        if constexpr (sizeof(CharT) == 1)
+        {
+            if (lead < 0x80U)
+            {
+                return {.value = lead, .length = 1, .valid = true};
+            }
+
+            std::size_t length{};
+            std::uint32_t value{};
+            std::uint32_t lower{0x80U};
+            std::uint32_t upper{0xBFU};
+            if (lead >= 0xC2U && lead <= 0xDFU)
+            {
+                length = 2;
+                value = lead & 0x1FU;
+            }
+            else if (lead >= 0xE0U && lead <= 0xEFU)
+            {
+                length = 3;
+                value = lead & 0x0FU;
+                lower = lead == 0xE0U ? 0xA0U : lower;
+                upper = lead == 0xEDU ? 0x9FU : upper;
+            }
+            else if (lead >= 0xF0U && lead <= 0xF4U)
+            {
+                length = 4;
+                value = lead & 0x07U;
+                lower = lead == 0xF0U ? 0x90U : lower;
+                upper = lead == 0xF4U ? 0x8FU : upper;
+            }
+            else
+            {
+                return {};
+            }
+
+            if (text.size() < length)
+            {
+                return {};
+            }
+
+            for (std::size_t i{1}; i != length; ++i)
+            {
+                auto const unit{detail::code_unit(text[i])};
+                if (unit < lower || unit > upper)
+                {
+                    return {};
+                }
+                value = (value << 6U) | (unit & 0x3FU);
+                lower = 0x80U;
+                upper = 0xBFU;
+            }
+
+            return {.value = value, .length = length, .valid = true};
+        }
+        else if constexpr (sizeof(CharT) == 2)
+        {
+            if (lead < 0xD800U || lead > 0xDFFFU)
+            {
+                return {.value = lead, .length = 1, .valid = true};
+            }
+
+            if (lead > 0xDBFFU || text.size() < 2)
+            {
+                return {};
+            }
+
+            auto const trail{detail::code_unit(text[1])};
+            if (trail < 0xDC00U || trail > 0xDFFFU)
+            {
+                return {};
+            }
+
+            return {.value = 0x10000U + ((lead - 0xD800U) << 10U) +
+                    (trail - 0xDC00U),
+                .length = 2,
+                .valid = true};
+        }
+        else
+        {
+            if (lead > 0x10FFFFU || (lead >= 0xD800U && lead <= 0xDFFFU))
+            {
+                return {};
+            }
+
+            return {.value = lead, .length = 1, .valid = true};
+        }
+    }
+
+    template<typename CharT>
+    [[nodiscard]] constexpr bool is_ascii(std::span<CharT const> text) noexcept
+    {
+        // Without early exit the loop is vectorized by the compiler
+        std::uint32_t accumulator{};
+        for (CharT const value : text)
+        {
+            accumulator |= detail::code_unit(value);
+        }
+        return accumulator < 0x80U;
+    }
+
+    template<typename CharT>
+    [[nodiscard]] constexpr std::size_t count_code_points(
+        std::span<CharT const> text) noexcept
+    {
+        std::size_t rv{};
+        for (CharT const value : text)
+        {
+            rv += static_cast<std::size_t>(is_code_point_start(value));
+        }
+        return rv;
+    }
+
+    // Number of terminal columns used by code points starting in the
+    // [first, last) range, sequences are decoded up to the end of the text.
+    // Code units which don't decode are displayed as replacement characters,
+    // one column each.
+    template<typename CharT>
+    [[nodiscard]] constexpr std::size_t count_columns(
+        std::span<CharT const> text,
+        std::size_t first,
+        std::size_t last) noexcept
+    {
+        std::size_t rv{};
+        while (first < last)
+        {
+            if (detail::code_unit(text[first]) < 0x80U)
+            {
+                ++rv;
+                ++first;
+            }
+            else if (!is_code_point_start(text[first]))
+            {
+                // Continuation of a code point starting before the range
+                // or a stray code unit
+                auto lead{first};
+                while (lead != 0 && first - lead + 1 <
+                        detail::max_sequence_length<CharT> &&
+                    !is_code_point_start(text[lead]))
+                {
+                    --lead;
+                }
+
+                auto const decoded{decode(text.subspan(lead))};
+                if (decoded.valid && lead + decoded.length > first)
+                {
+                    first = lead + decoded.length;
+                }
+                else
+                {
+                    ++rv;
+                    ++first;
+                }
+            }
+            else
+            {
+                auto const decoded{decode(text.subspan(first))};
+                rv += display_width(decoded.value);
+                first += decoded.length;
+            }
+        }
+        return rv;
+    }
+
+    template<typename CharT>
+    [[nodiscard]] constexpr bool is_valid_encoding(
+        std::span<CharT const> text) noexcept
+    {
+        while (!text.empty())
+        {
+            if (text.size() >= detail::ascii_block_size &&
+                is_ascii(text.first(detail::ascii_block_size)))
+            {
+                text = text.subspan(detail::ascii_block_size);
+                continue;
+            }
+
+            auto const decoded{decode(text)};
+            if (!decoded.valid)
+            {
+                return false;
+            }
+            text = text.subspan(decoded.length);
+        }
+        return true;
+    }
+} // namespace afv::buf
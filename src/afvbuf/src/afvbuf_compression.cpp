@@ -0,0 +1,228 @@
+#include <afvbuf_compression.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace
+{
+    constexpr std::size_t min_match{4};
+    constexpr std::size_t max_offset{0xFFFF};
+    constexpr std::size_t hash_bits{12};
+
+    // Length which doesn't fit into a half of the token byte is continued in
+    // following bytes
+    constexpr std::size_t token_length_limit{15};
+    constexpr std::size_t length_byte_limit{255};
+
+    // Number of missed matches after which positions are skipped faster
+    constexpr unsigned skip_shift{6};
+
+    [[nodiscard]] std::uint32_t read32(std::span<std::byte const> data,
+        std::size_t const position) noexcept
+    {
+        std::uint32_t rv{};
+        std::memcpy(&rv, data.subspan(position).data(), sizeof(rv));
+        return rv;
+    }
+
+    [[nodiscard]] std::size_t hash(std::uint32_t const value) noexcept
+    {
+        return (value * 2654435761U) >> (32 - hash_bits);
+    }
+
+    class [[nodiscard]] writer final
+    {
+    public: // Construction
+        explicit writer(std::span<std::byte> output) noexcept
+            : output_{output}
+        {
+        }
+
+    public: // Interface
+        [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+        void put(std::size_t const value) noexcept
+        {
+            output_[size_++] = static_cast<std::byte>(value);
+        }
+
+        // Continuation of a length which reached the token limit
+        void put_length(std::size_t length) noexcept
+        {
+            for (; length >= length_byte_limit; length -= length_byte_limit)
+            {
+                put(length_byte_limit);
+            }
+            put(length);
+        }
+
+        void put_sequence(std::span<std::byte const> const literals,
+            std::size_t const offset,
+            std::size_t const match) noexcept
+        {
+            auto const literal_token{
+                std::min(literals.size(), token_length_limit)};
+            auto const match_token{std::min(match, token_length_limit)};
+            put((literal_token << 4U) | match_token);
+            if (literal_token == token_length_limit)
+            {
+                put_length(literals.size() - token_length_limit);
+            }
+
+            std::ranges::copy(literals, output_.subspan(size_).begin());
+            size_ += literals.size();
+
+            if (offset != 0)
+            {
+                put(offset & 0xFFU);
+                put(offset >> 8U);
+                if (match_token == token_length_limit)
+                {
+                    put_length(match - token_length_limit);
+                }
+            }
+        }
+
+    private: // Data
+        std::span<std::byte> output_;
+        std::size_t size_{};
+    };
+
+    class [[nodiscard]] reader final
+    {
+    public: // Construction
+        explicit reader(std::span<std::byte const> data) noexcept
+            : data_{data}
+        {
+        }
+
+    public: // Interface
+        [[nodiscard]] bool done() const noexcept
+        {
+            return position_ == data_.size();
+        }
+
+        [[nodiscard]] std::size_t get() noexcept
+        {
+            return std::to_integer<std::size_t>(data_[position_++]);
+        }
+
+        [[nodiscard]] std::size_t get_length(std::size_t length) noexcept
+        {
+            if (length == token_length_limit)
+            {
+                std::size_t byte{};
+                do
+                {
+                    byte = get();
+                    length += byte;
+                } while (byte == length_byte_limit);
+            }
+            return length;
+        }
+
+        [[nodiscard]] std::span<std::byte const> take(
+            std::size_t const count) noexcept
+        {
+            auto const rv{data_.subspan(position_, count)};
+            position_ += count;
+            return rv;
+        }
+
+    private: // Data
+        std::span<std::byte const> data_;
+        std::size_t position_{};
+    };
+} // namespace
+
+std::size_t afv::buf::compress_bound(std::size_t const size) noexcept
+{
+    // Incompressible data is a single sequence of literals
+    return size + size / length_byte_limit + 2;
+}
+
+std::size_t afv::buf::compress(std::span<std::byte const> const data,
+    std::span<std::byte> const output) noexcept
+{
+    writer out{output};
+
+    std::array<std::size_t, std::size_t{1} << hash_bits> table{};
+    std::size_t anchor{};
+    std::size_t position{};
+    while (position + min_match <= data.size())
+    {
+        auto const value{read32(data, position)};
+        auto& entry{table[hash(value)]};
+        auto const candidate{entry};
+        entry = position;
+
+        if (candidate >= position || position - candidate > max_offset ||
+            read32(data, candidate) != value)
+        {
+            position += 1 + ((position - anchor) >> skip_shift);
+            continue;
+        }
+
+        auto length{min_match};
+        while (position + length != data.size() &&
+            data[candidate + length] == data[position + length])
+        {
+            ++length;
+        }
+
+        out.put_sequence(data.subspan(anchor, position - anchor),
+            position - candidate,
+            length - min_match);
+        position += length;
+        anchor = position;
+    }
+
+    if (anchor != data.size())
+    {
+        out.put_sequence(data.subspan(anchor), 0, 0);
+    }
+
+    return out.size();
+}
+
+void afv::buf::decompress(std::span<std::byte const> const data,
+    std::span<std::byte> const output) noexcept
+{
+    reader in{data};
+    std::size_t size{};
+    while (!in.done())
+    {
+        auto const token{in.get()};
+
+        auto const literals{in.take(in.get_length(token >> 4U))};
+        std::ranges::copy(literals, output.subspan(size).begin());
+        size += literals.size();
+        if (in.done())
+        {
+            break;
+        }
+
+        auto const offset_low{in.get()};
+        auto const offset{offset_low | (in.get() << 8U)};
+        auto const length{
+            in.get_length(token & token_length_limit) + min_match};
+
+        auto const match{output.subspan(size - offset, length)};
+        if (offset >= length)
+        {
+            std::ranges::copy(match, output.subspan(size).begin());
+        }
+        else // Overlapping copy repeats the pattern, copy forward
+        {
+            for (std::size_t i{}; i != length; ++i)
+            {
+                output[size + i] = match[i];
+            }
+        }
+        size += length;
+    }
+}
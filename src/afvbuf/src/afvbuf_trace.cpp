@@ -0,0 +1,179 @@
+#include <afvbuf_trace.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iterator>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    // Sequence of a slot is odd while event with index i is written to it
+    // and 2 * (i + 1) after it was written
+    struct slot final
+    {
+        std::atomic<std::size_t> sequence;
+        std::atomic<char const*> name;
+        std::atomic<std::uint64_t> start;
+        std::atomic<std::uint64_t> duration;
+        std::atomic<std::uint32_t> thread;
+    };
+
+    struct ring final
+    {
+        std::array<slot, afv::buf::detail::trace_capacity> slots;
+        std::atomic<std::size_t> next_event;
+        std::atomic<std::uint32_t> next_thread;
+    };
+
+    [[nodiscard]] ring& trace_ring() noexcept
+    {
+        constinit static ring rv{};
+        return rv;
+    }
+
+    [[nodiscard]] std::uint32_t thread_index() noexcept
+    {
+        thread_local std::uint32_t const rv{
+            trace_ring().next_thread.fetch_add(1, std::memory_order_relaxed)};
+        return rv;
+    }
+
+    void write_json_string(std::ostream& out, std::string_view const text)
+    {
+        out << '"';
+        for (char const c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << '"';
+    }
+
+    // Chrome trace times are microseconds
+    void write_microseconds(std::ostream& out, std::uint64_t const nanoseconds)
+    {
+        auto const fill{out.fill('0')};
+        out << nanoseconds / 1000 << '.' << std::setw(3) << nanoseconds % 1000;
+        out.fill(fill);
+    }
+} // namespace
+
+std::uint64_t afv::buf::detail::trace_clock() noexcept
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void afv::buf::detail::record_trace_event(char const* const name,
+    std::uint64_t const start,
+    std::uint64_t const end) noexcept
+{
+    auto& r{trace_ring()};
+    auto const index{r.next_event.fetch_add(1, std::memory_order_relaxed)};
+    auto& s{r.slots[index % trace_capacity]};
+
+    s.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.name.store(name, std::memory_order_relaxed);
+    s.start.store(start, std::memory_order_relaxed);
+    s.duration.store(end - start, std::memory_order_relaxed);
+    s.thread.store(thread_index(), std::memory_order_relaxed);
+    s.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<afv::buf::trace_event> afv::buf::trace_events()
+{
+    auto& r{trace_ring()};
+    auto const last{r.next_event.load(std::memory_order_acquire)};
+    auto const first{last - std::min(last, detail::trace_capacity)};
+
+    std::vector<trace_event> rv;
+    rv.reserve(last - first);
+    for (auto index{first}; index != last; ++index)
+    {
+        auto const& s{r.slots[index % detail::trace_capacity]};
+        auto const sequence{s.sequence.load(std::memory_order_acquire)};
+        if (sequence != 2 * index + 2)
+        {
+            continue;
+        }
+
+        trace_event const event{
+            .name = s.name.load(std::memory_order_relaxed),
+            .start = s.start.load(std::memory_order_relaxed),
+            .duration = s.duration.load(std::memory_order_relaxed),
+            .thread = s.thread.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            rv.push_back(event);
+        }
+    }
+    return rv;
+}
+
+void afv::buf::write_chrome_trace(std::ostream& out,
+    std::span<trace_event const> const events)
+{
+    auto const origin{events.empty()
+            ? std::uint64_t{}
+            : std::ranges::min(events, {}, &trace_event::start).start};
+
+    out << "{\"traceEvents\":[";
+    for (bool first{true}; trace_event const& event : events)
+    {
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        write_json_string(out, event.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"ts\":";
+        write_microseconds(out, event.start - origin);
+        out << ",\"dur\":";
+        write_microseconds(out, event.duration);
+        out << '}';
+        first = false;
+    }
+    out << "\n]}\n";
+}
+
+std::uint64_t afv::buf::trace_percentile(
+    std::span<trace_event const> const events,
+    std::string_view const name,
+    double const percentile)
+{
+    std::vector<std::uint64_t> durations;
+    for (trace_event const& event : events)
+    {
+        if (event.name == name)
+        {
+            durations.push_back(event.duration);
+        }
+    }
+
+    if (durations.empty())
+    {
+        return 0;
+    }
+
+    // Nearest rank
+    auto const rank{static_cast<std::size_t>(std::ceil(
+        std::clamp(percentile, 0.0, 100.0) / 100.0 *
+        static_cast<double>(durations.size())))};
+    auto const nth{std::next(durations.begin(),
+        static_cast<std::ptrdiff_t>(std::max<std::size_t>(rank, 1) - 1))};
+    std::ranges::nth_element(durations, nth);
+    return *nth;
+}
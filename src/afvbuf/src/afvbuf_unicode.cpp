@@ -0,0 +1,151 @@
+#include <afvbuf_unicode.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace
+{
+    struct code_point_range final
+    {
+        char32_t first;
+        char32_t last;
+    };
+
+    // Combining marks, format and other characters without a glyph
+    constexpr std::array zero_width{code_point_range{0x0300, 0x036F},
+        code_point_range{0x0483, 0x0489},
+        code_point_range{0x0591, 0x05BD},
+        code_point_range{0x05BF, 0x05BF},
+        code_point_range{0x05C1, 0x05C2},
+        code_point_range{0x05C4, 0x05C5},
+        code_point_range{0x05C7, 0x05C7},
+        code_point_range{0x0610, 0x061A},
+        code_point_range{0x064B, 0x065F},
+        code_point_range{0x0670, 0x0670},
+        code_point_range{0x06D6, 0x06DC},
+        code_point_range{0x06DF, 0x06E4},
+        code_point_range{0x06E7, 0x06E8},
+        code_point_range{0x06EA, 0x06ED},
+        code_point_range{0x0711, 0x0711},
+        code_point_range{0x0730, 0x074A},
+        code_point_range{0x07A6, 0x07B0},
+        code_point_range{0x0900, 0x0902},
+        code_point_range{0x093A, 0x093A},
+        code_point_range{0x093C, 0x093C},
+        code_point_range{0x0941, 0x0948},
+        code_point_range{0x094D, 0x094D},
+        code_point_range{0x0951, 0x0957},
+        code_point_range{0x0962, 0x0963},
+        code_point_range{0x0E31, 0x0E31},
+        code_point_range{0x0E34, 0x0E3A},
+        code_point_range{0x0E47, 0x0E4E},
+        code_point_range{0x1160, 0x11FF},
+        code_point_range{0x1AB0, 0x1AFF},
+        code_point_range{0x1DC0, 0x1DFF},
+        code_point_range{0x200B, 0x200F},
+        code_point_range{0x202A, 0x202E},
+        code_point_range{0x2060, 0x2064},
+        code_point_range{0x20D0, 0x20FF},
+        code_point_range{0xFE00, 0xFE0F},
+        code_point_range{0xFE20, 0xFE2F},
+        code_point_range{0xFEFF, 0xFEFF},
+        code_point_range{0xE0001, 0xE0001},
+        code_point_range{0xE0020, 0xE007F},
+        code_point_range{0xE0100, 0xE01EF}};
+
+    // East Asian wide and fullwidth characters, emoji presentation
+    constexpr std::array double_width{code_point_range{0x1100, 0x115F},
+        code_point_range{0x231A, 0x231B},
+        code_point_range{0x2329, 0x232A},
+        code_point_range{0x23E9, 0x23EC},
+        code_point_range{0x23F0, 0x23F0},
+        code_point_range{0x23F3, 0x23F3},
+        code_point_range{0x25FD, 0x25FE},
+        code_point_range{0x2614, 0x2615},
+        code_point_range{0x2648, 0x2653},
+        code_point_range{0x267F, 0x267F},
+        code_point_range{0x2693, 0x2693},
+        code_point_range{0x26A1, 0x26A1},
+        code_point_range{0x26AA, 0x26AB},
+        code_point_range{0x26BD, 0x26BE},
+        code_point_range{0x26C4, 0x26C5},
+        code_point_range{0x26CE, 0x26CE},
+        code_point_range{0x26D4, 0x26D4},
+        code_point_range{0x26EA, 0x26EA},
+        code_point_range{0x26F2, 0x26F3},
+        code_point_range{0x26F5, 0x26F5},
+        code_point_range{0x26FA, 0x26FA},
+        code_point_range{0x26FD, 0x26FD},
+        code_point_range{0x2705, 0x2705},
+        code_point_range{0x270A, 0x270B},
+        code_point_range{0x2728, 0x2728},
+        code_point_range{0x274C, 0x274C},
+        code_point_range{0x274E, 0x274E},
+        code_point_range{0x2753, 0x2755},
+        code_point_range{0x2757, 0x2757},
+        code_point_range{0x2795, 0x2797},
+        code_point_range{0x27B0, 0x27B0},
+        code_point_range{0x27BF, 0x27BF},
+        code_point_range{0x2B1B, 0x2B1C},
+        code_point_range{0x2B50, 0x2B50},
+        code_point_range{0x2B55, 0x2B55},
+        code_point_range{0x2E80, 0x303E},
+        code_point_range{0x3041, 0x33FF},
+        code_point_range{0x3400, 0x4DBF},
+        code_point_range{0x4E00, 0x9FFF},
+        code_point_range{0xA000, 0xA4CF},
+        code_point_range{0xA960, 0xA97F},
+        code_point_range{0xAC00, 0xD7A3},
+        code_point_range{0xF900, 0xFAFF},
+        code_point_range{0xFE10, 0xFE19},
+        code_point_range{0xFE30, 0xFE6F},
+        code_point_range{0xFF00, 0xFF60},
+        code_point_range{0xFFE0, 0xFFE6},
+        code_point_range{0x16FE0, 0x16FE4},
+        code_point_range{0x17000, 0x18CFF},
+        code_point_range{0x1B000, 0x1B2FF},
+        code_point_range{0x1F004, 0x1F004},
+        code_point_range{0x1F0CF, 0x1F0CF},
+        code_point_range{0x1F18E, 0x1F18E},
+        code_point_range{0x1F191, 0x1F19A},
+        code_point_range{0x1F200, 0x1F251},
+        code_point_range{0x1F300, 0x1F64F},
+        code_point_range{0x1F680, 0x1F6FF},
+        code_point_range{0x1F7E0, 0x1F7EB},
+        code_point_range{0x1F90C, 0x1F9FF},
+        code_point_range{0x1FA70, 0x1FAFF},
+        code_point_range{0x20000, 0x2FFFD},
+        code_point_range{0x30000, 0x3FFFD}};
+
+    template<std::size_t Size>
+    [[nodiscard]] bool contains(std::array<code_point_range, Size> const& table,
+        char32_t const code_point) noexcept
+    {
+        auto const it{std::ranges::lower_bound(table,
+            code_point,
+            std::ranges::less{},
+            &code_point_range::last)};
+        return it != table.cend() && it->first <= code_point;
+    }
+} // namespace
+
+std::size_t afv::buf::display_width(char32_t const code_point) noexcept
+{
+    if (code_point < 0x300)
+    {
+        return 1;
+    }
+
+    if (contains(zero_width, code_point))
+    {
+        return 0;
+    }
+
+    if (contains(double_width, code_point))
+    {
+        return 2;
+    }
+
+    return 1;
+}
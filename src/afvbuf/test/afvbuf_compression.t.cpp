@@ -0,0 +1,133 @@
+#include <afvbuf_compression.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    [[nodiscard]] std::vector<std::byte> round_trip(std::string_view text,
+        std::size_t& compressed_size)
+    {
+        auto const data{std::as_bytes(std::span{text})};
+        std::vector<std::byte> compressed(afv::buf::compress_bound(data.size()));
+        compressed_size = afv::buf::compress(data, compressed);
+        REQUIRE(compressed_size <= compressed.size());
+        compressed.resize(compressed_size);
+
+        std::vector<std::byte> rv(data.size());
+        afv::buf::decompress(compressed, rv);
+        return rv;
+    }
+} // namespace
+
+TEST_CASE("afv::buf::compress")
+{
+    using namespace std::string_view_literals;
+
+    SECTION("compress() round trip of short and empty data")
+    {
+        for (auto const text : {""sv, "a"sv, "abcd"sv, "abcdabcd"sv})
+        {
+            std::size_t size{};
+            auto const bytes{std::as_bytes(std::span{text})};
+            REQUIRE(std::ranges::equal(round_trip(text, size), bytes));
+        }
+    }
+
+    SECTION("compress() repetitive text")
+    {
+        std::string text;
+        for (int i{}; i != 1000; ++i)
+        {
+            text.append("the quick brown fox jumps over the lazy dog\n");
+        }
+
+        std::size_t size{};
+        auto const bytes{std::as_bytes(std::span{text})};
+        REQUIRE(std::ranges::equal(round_trip(text, size), bytes));
+        REQUIRE(size < text.size() / 10);
+    }
+
+    SECTION("compress() log text to a third of its size")
+    {
+        // Log lines with varying fields and a random identifier each
+        constexpr std::array levels{"INFO ", "DEBUG", "WARN ", "ERROR"};
+        constexpr std::array sources{"[http.server] request completed",
+            "[db.pool] connection acquired",
+            "[auth] token refreshed for user",
+            "[scheduler] job finished",
+            "[cache] miss for key"};
+
+        std::string text;
+        std::uint32_t state{2463534242U};
+        std::uint32_t milliseconds{};
+        while (text.size() < (std::size_t{1} << 20))
+        {
+            state ^= state << 13U;
+            state ^= state >> 17U;
+            state ^= state << 5U;
+            milliseconds += state % 50;
+
+            auto const time{std::to_string(1000000 + milliseconds)};
+            text.append("2024-03-14 12:")
+                .append(time.substr(1, 2))
+                .append(":")
+                .append(time.substr(3, 2))
+                .append(".")
+                .append(time.substr(4, 3))
+                .append(" ")
+                .append(levels[state % levels.size()])
+                .append(" ")
+                .append(sources[(state >> 4U) % sources.size()])
+                .append(" id=");
+            for (std::uint32_t id{state}, i{}; i != 8; ++i, id >>= 4U)
+            {
+                text.push_back("0123456789abcdef"[id & 0xFU]);
+            }
+            text.append(" latency=")
+                .append(std::to_string((state >> 8U) % 900))
+                .append("ms status=")
+                .append((state >> 20U) % 4 == 0 ? "500\n" : "200\n");
+        }
+
+        std::size_t size{};
+        auto const bytes{std::as_bytes(std::span{text})};
+        REQUIRE(std::ranges::equal(round_trip(text, size), bytes));
+        REQUIRE(size < text.size() / 3);
+    }
+
+    SECTION("compress() overlapping matches and long lengths")
+    {
+        std::string text(100000, 'a');
+        text.append("b");
+        text.append(300, 'c');
+
+        std::size_t size{};
+        auto const bytes{std::as_bytes(std::span{text})};
+        REQUIRE(std::ranges::equal(round_trip(text, size), bytes));
+    }
+
+    SECTION("compress() incompressible data")
+    {
+        std::string text;
+        std::uint32_t state{12345};
+        for (int i{}; i != 100000; ++i)
+        {
+            state = state * 1664525U + 1013904223U;
+            text.push_back(static_cast<char>(state >> 24U));
+        }
+
+        std::size_t size{};
+        auto const bytes{std::as_bytes(std::span{text})};
+        REQUIRE(std::ranges::equal(round_trip(text, size), bytes));
+        REQUIRE(size <= afv::buf::compress_bound(text.size()));
+    }
+}
@@ -0,0 +1,141 @@
+#include <afvbuf_diff.hpp>
+
+#include <afvbuf_text_buffer.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+TEST_CASE("afv::buf::diff")
+{
+    using namespace std::string_view_literals;
+
+    using afv::buf::diff_hunk;
+    using text_buffer = afv::buf::text_buffer;
+
+    SECTION("copies without edits don't differ")
+    {
+        text_buffer old_version;
+        old_version.insert(0, "one\ntwo\nthree\n"sv);
+        old_version.insert(4, "four\n"sv);
+        text_buffer const new_version{old_version};
+
+        REQUIRE(afv::buf::diff(old_version, new_version).empty());
+    }
+
+    SECTION("insertion into a copy is a hunk of new lines only")
+    {
+        text_buffer old_version;
+        old_version.insert(0, "one\ntwo\nthree\n"sv);
+        text_buffer new_version{old_version};
+        new_version.insert(4, "four\n"sv);
+
+        REQUIRE(afv::buf::diff(old_version, new_version) ==
+            std::vector<diff_hunk>{{.old_offset = 4,
+                .old_length = 0,
+                .new_offset = 4,
+                .new_length = 5,
+                .old_first_line = 1,
+                .old_last_line = 1,
+                .new_first_line = 1,
+                .new_last_line = 2}});
+    }
+
+    SECTION("insertions on different lines are separate hunks")
+    {
+        text_buffer old_version;
+        old_version.insert(0, "one\ntwo\nthree\n"sv);
+        text_buffer new_version{old_version};
+        new_version.insert(8, "THREE "sv);
+        new_version.insert(3, "!"sv);
+
+        REQUIRE(afv::buf::diff(old_version, new_version) ==
+            std::vector<diff_hunk>{{.old_offset = 3,
+                                       .old_length = 0,
+                                       .new_offset = 3,
+                                       .new_length = 1,
+                                       .old_first_line = 0,
+                                       .old_last_line = 0,
+                                       .new_first_line = 0,
+                                       .new_last_line = 1},
+                {.old_offset = 8,
+                    .old_length = 0,
+                    .new_offset = 9,
+                    .new_length = 6,
+                    .old_first_line = 2,
+                    .old_last_line = 2,
+                    .new_first_line = 2,
+                    .new_last_line = 3}});
+    }
+
+    SECTION("batch of thousands of insertions is a hunk per line")
+    {
+        constexpr std::size_t lines{5000};
+
+        text_buffer old_version;
+        for (std::size_t i{}; i != lines; ++i)
+        {
+            old_version.insert(old_version.size(), "line\n"sv);
+        }
+
+        std::vector<std::pair<std::size_t, std::string_view>> insertions;
+        for (std::size_t i{}; i != lines; ++i)
+        {
+            insertions.emplace_back(5 * i + 4, "!"sv);
+        }
+        text_buffer new_version{old_version};
+        new_version.insert_batch(insertions);
+
+        std::vector<diff_hunk> expected;
+        for (std::size_t i{}; i != lines; ++i)
+        {
+            expected.push_back({.old_offset = 5 * i + 4,
+                .old_length = 0,
+                .new_offset = 6 * i + 4,
+                .new_length = 1,
+                .old_first_line = i,
+                .old_last_line = i,
+                .new_first_line = i,
+                .new_last_line = i + 1});
+        }
+        REQUIRE(afv::buf::diff(old_version, new_version) == expected);
+    }
+
+    SECTION("myers() finds the longest common subsequence")
+    {
+        auto constexpr old_text{"abcabba"sv};
+        auto constexpr new_text{"cbabac"sv};
+        auto const equal = [&](std::size_t i, std::size_t j)
+        { return old_text[i] == new_text[j]; };
+
+        auto const runs{afv::buf::detail::myers(old_text.size(),
+            new_text.size(),
+            equal,
+            old_text.size() + new_text.size())};
+        REQUIRE(runs.has_value());
+
+        std::size_t common{};
+        std::size_t old_index{};
+        std::size_t new_index{};
+        for (auto const& run : *runs)
+        {
+            REQUIRE(run.old_index >= old_index);
+            REQUIRE(run.new_index >= new_index);
+            REQUIRE(old_text.substr(run.old_index, run.length) ==
+                new_text.substr(run.new_index, run.length));
+            common += run.length;
+            old_index = run.old_index + run.length;
+            new_index = run.new_index + run.length;
+        }
+        REQUIRE(common == 4);
+
+        REQUIRE_FALSE(afv::buf::detail::myers(old_text.size(),
+            new_text.size(),
+            equal,
+            4)
+                .has_value());
+    }
+}
@@ -0,0 +1,125 @@
+#include <afvbuf_line_state_cache.hpp>
+
+#include <afvbuf_text_buffer.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <ranges>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    // Tracks whether a line starts inside of a /* */ comment
+    struct comment_lexer final
+    {
+        std::size_t* calls;
+
+        template<std::ranges::forward_range Line>
+        bool operator()(bool in_comment, Line const& line) const
+        {
+            ++*calls;
+            std::string const content(std::ranges::begin(line),
+                std::ranges::end(line));
+            for (std::size_t i{}; i + 1 < content.size(); ++i)
+            {
+                if (content.compare(i, 2, in_comment ? "*/" : "/*") == 0)
+                {
+                    in_comment = !in_comment;
+                    ++i;
+                }
+            }
+            return in_comment;
+        }
+    };
+
+    std::string repeated_lines(std::size_t const count)
+    {
+        std::string rv;
+        for (std::size_t i{}; i != count; ++i)
+        {
+            rv += "x\n";
+        }
+        return rv;
+    }
+} // namespace
+
+TEST_CASE("afv::buf::line_state_cache")
+{
+    using namespace std::string_view_literals;
+
+    using afv::buf::text_buffer;
+
+    std::size_t calls{};
+    afv::buf::line_state_cache cache{comment_lexer{&calls}, false};
+
+    SECTION("state() lexes lines up to the requested line once")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "a /* b\nc\nd */ e\nf\n"sv);
+
+        REQUIRE(cache.state(buffer, 2));
+        REQUIRE(calls == 2);
+
+        REQUIRE_FALSE(cache.state(buffer, 0));
+        REQUIRE(cache.state(buffer, 1));
+        REQUIRE_FALSE(cache.state(buffer, 3));
+        REQUIRE_FALSE(cache.state(buffer, 4));
+        REQUIRE(calls == 4);
+    }
+
+    SECTION("edit which doesn't change the state lexes the edited line")
+    {
+        text_buffer buffer;
+        buffer.insert(0, repeated_lines(1000));
+        REQUIRE_FALSE(cache.state(buffer, 1000));
+
+        buffer.insert(buffer.line_offset(500), "y"sv);
+        cache.invalidate(500, 1, 1);
+        calls = 0;
+
+        REQUIRE_FALSE(cache.state(buffer, 1000));
+        REQUIRE(calls == 1);
+    }
+
+    SECTION("change of state ripples until the states converge")
+    {
+        text_buffer buffer;
+        buffer.insert(0, repeated_lines(1000));
+        buffer.insert(buffer.line_offset(600), "*/"sv);
+        REQUIRE_FALSE(cache.state(buffer, 1000));
+
+        buffer.insert(buffer.line_offset(500), "/*"sv);
+        cache.invalidate(500, 1, 1);
+        calls = 0;
+
+        REQUIRE_FALSE(cache.state(buffer, 1000));
+        REQUIRE(calls == 101);
+        REQUIRE_FALSE(cache.state(buffer, 500));
+        REQUIRE(cache.state(buffer, 501));
+        REQUIRE(cache.state(buffer, 600));
+        REQUIRE_FALSE(cache.state(buffer, 601));
+    }
+
+    SECTION("states after multiple edits match states of a new cache")
+    {
+        text_buffer buffer;
+        buffer.insert(0, repeated_lines(100));
+        REQUIRE_FALSE(cache.state(buffer, 100));
+
+        buffer.insert(buffer.line_offset(70), "*/"sv);
+        cache.invalidate(70, 1, 1);
+        buffer.insert(buffer.line_offset(10), "p /*\nq\n"sv);
+        cache.invalidate(10, 1, 3);
+        buffer.insert(buffer.line_offset(40), "\n/* r */\n"sv);
+        cache.invalidate(40, 1, 3);
+
+        std::size_t fresh_calls{};
+        afv::buf::line_state_cache fresh{comment_lexer{&fresh_calls}, false};
+        for (std::size_t line{}; line <= buffer.lines(); ++line)
+        {
+            REQUIRE(cache.state(buffer, line) == fresh.state(buffer, line));
+        }
+    }
+}
@@ -3,9 +3,13 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include <algorithm>
+#include <cstddef>
+#include <span>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 // IWYU pragma: no_include <functional>
 
@@ -83,6 +87,78 @@ TEST_CASE("afv:::buf::basic_text_buffer insertion")
     }
 }
 
+TEST_CASE("afv::buf::basic_text_buffer batch insertion")
+{
+    using namespace std::string_view_literals;
+
+    using text_buffer = afv::buf::text_buffer;
+    using insertions = std::vector<std::pair<std::size_t, std::string_view>>;
+    SECTION("insert_batch() on empty buffer")
+    {
+        text_buffer buffer;
+        buffer.insert_batch(insertions{{0, "abc"sv}, {0, "def"sv}});
+
+        REQUIRE(std::ranges::equal(buffer, "abcdef"sv));
+    }
+
+    SECTION("insert_batch() positions refer to content before the batch")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abcdef"sv);
+        buffer.insert_batch(
+            insertions{{6, "!"sv}, {3, "-"sv}, {0, "<"sv}, {3, "+"sv}});
+
+        REQUIRE(std::ranges::equal(buffer, "<abc-+def!"sv));
+    }
+
+    SECTION("insert_batch() splits multiple nodes")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abc"sv);
+        buffer.insert(3, "def"sv);
+        buffer.insert(1, "ghi"sv);
+        REQUIRE(std::ranges::equal(buffer, "aghibcdef"sv));
+
+        buffer.insert_batch(insertions{{2, "1"sv},
+            {5, "2"sv},
+            {7, "3"sv},
+            {8, "4"sv},
+            {9, "5"sv}});
+
+        REQUIRE(std::ranges::equal(buffer, "ag1hib2cd3e4f5"sv));
+    }
+
+    SECTION("insert_batch() matches consecutive insert() calls")
+    {
+        text_buffer batched;
+        text_buffer sequential;
+        batched.insert(0, "0123456789"sv);
+        sequential.insert(0, "0123456789"sv);
+
+        batched.insert_batch(insertions{{2, "ab"sv}, {7, "cd"sv}});
+        sequential.insert(7, "cd"sv);
+        sequential.insert(2, "ab"sv);
+
+        REQUIRE(std::ranges::equal(batched, sequential));
+
+        batched.insert_batch(insertions{{5, "ef"sv}, {13, "gh"sv}});
+        sequential.insert(13, "gh"sv);
+        sequential.insert(5, "ef"sv);
+
+        REQUIRE(std::ranges::equal(batched, sequential));
+    }
+
+    SECTION("insert_batch() with newline characters increases line count")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abc"sv);
+        buffer.insert_batch(insertions{{1, "\n"sv}, {2, "\n"sv}, {3, ""sv}});
+
+        REQUIRE(buffer.lines() == 3);
+        REQUIRE(std::ranges::equal(buffer, "a\nb\nc"sv));
+    }
+}
+
 TEST_CASE("afv::buf::basic_text_buffer iterators")
 {
     using namespace std::string_view_literals;
@@ -146,3 +222,440 @@ TEST_CASE("afv::buf::basic_text_buffer lines")
         REQUIRE(std::ranges::equal(""sv, buffer.line(1)));
     }
 }
+
+TEST_CASE("afv::buf::basic_text_buffer positions")
+{
+    using namespace std::string_view_literals;
+
+    SECTION("position() of ASCII text")
+    {
+        afv::buf::text_buffer buffer;
+        buffer.insert(0, "abc\ndef"sv);
+
+        REQUIRE(buffer.size() == 7);
+        REQUIRE(buffer.position(0) == afv::buf::text_position{0, 0, 0});
+        REQUIRE(buffer.position(2) == afv::buf::text_position{0, 2, 2});
+        REQUIRE(buffer.position(4) == afv::buf::text_position{1, 0, 0});
+        REQUIRE(buffer.position(7) == afv::buf::text_position{1, 3, 3});
+    }
+
+    SECTION("position() counts code points and display columns")
+    {
+        afv::buf::u8text_buffer buffer;
+        buffer.insert(0, u8"x\n\u00E9\u65E5e\u0301z"sv);
+
+        // Offsets of e with acute accent, wide character, e, combining accent
+        // and z
+        REQUIRE(buffer.position(2) == afv::buf::text_position{1, 0, 0});
+        REQUIRE(buffer.position(4) == afv::buf::text_position{1, 1, 1});
+        REQUIRE(buffer.position(7) == afv::buf::text_position{1, 2, 3});
+        REQUIRE(buffer.position(8) == afv::buf::text_position{1, 3, 4});
+        REQUIRE(buffer.position(10) == afv::buf::text_position{1, 4, 4});
+        REQUIRE(buffer.line_width(1) == 5);
+    }
+
+    SECTION("position() across multiple nodes")
+    {
+        afv::buf::u8text_buffer buffer;
+        buffer.insert(0, u8"\u65E5\u65E5"sv);
+        buffer.insert(3, u8"a\nb"sv);
+        buffer.insert(0, u8"\u00E9"sv);
+
+        REQUIRE(std::ranges::equal(buffer, u8"\u00E9\u65E5a\nb\u65E5"sv));
+        REQUIRE(buffer.position(6) == afv::buf::text_position{0, 3, 4});
+        REQUIRE(buffer.position(8) == afv::buf::text_position{1, 1, 1});
+        REQUIRE(buffer.position(11) == afv::buf::text_position{1, 2, 3});
+    }
+
+    SECTION("column_offset() maps columns to offsets")
+    {
+        afv::buf::u8text_buffer buffer;
+        buffer.insert(0, u8"ab\n\u65E5c\u00E9\nd"sv);
+
+        REQUIRE(buffer.column_offset(0, 1) == 1);
+        REQUIRE(buffer.column_offset(1, 0) == 3);
+        REQUIRE(buffer.column_offset(1, 1) == 3);
+        REQUIRE(buffer.column_offset(1, 2) == 6);
+        REQUIRE(buffer.column_offset(1, 3) == 7);
+        REQUIRE(buffer.column_offset(1, 10) == 9);
+        REQUIRE(buffer.column_offset(2, 10) == 11);
+    }
+
+    SECTION("columns of invalid input match its replacement characters")
+    {
+        afv::buf::text_buffer buffer;
+        buffer.insert(0, "a\x81" "b\xE2\x82" "c\n\xC3\xA9\xA9"sv);
+
+        // Every code unit which doesn't decode is one column wide
+        REQUIRE(buffer.line_width(0) == 6);
+        REQUIRE(buffer.position(3) == afv::buf::text_position{0, 2, 3});
+        REQUIRE(buffer.column_offset(0, 1) == 1);
+        REQUIRE(buffer.column_offset(0, 4) == 4);
+        REQUIRE(buffer.column_offset(0, 5) == 5);
+        REQUIRE(buffer.line_width(1) == 2);
+        REQUIRE(buffer.column_offset(1, 1) == 9);
+    }
+
+    SECTION("code_point_offset() maps code points to offsets")
+    {
+        afv::buf::u8text_buffer buffer;
+        buffer.insert(0, u8"ab\n\u65E5c\u00E9\nd"sv);
+
+        REQUIRE(buffer.code_point_offset(1, 0) == 3);
+        REQUIRE(buffer.code_point_offset(1, 1) == 6);
+        REQUIRE(buffer.code_point_offset(1, 2) == 7);
+        REQUIRE(buffer.code_point_offset(1, 3) == 9);
+    }
+
+    SECTION("positions on a line longer than the checkpoint interval")
+    {
+        std::u8string text;
+        for (std::size_t i{}; i != 5000; ++i)
+        {
+            text += u8"\u00E9\u65E5";
+        }
+
+        afv::buf::u8text_buffer buffer;
+        buffer.insert(0, text);
+        buffer.insert(0, u8"\n"sv);
+
+        REQUIRE(buffer.line_width(1) == 15000);
+        REQUIRE(buffer.position(1 + 5 * 4000) ==
+            afv::buf::text_position{1, 8000, 12000});
+        REQUIRE(buffer.column_offset(1, 12000) == 1 + 5 * 4000);
+        REQUIRE(buffer.column_offset(1, 12002) == 1 + 5 * 4000 + 2);
+        REQUIRE(buffer.code_point_offset(1, 8001) == 1 + 5 * 4000 + 2);
+    }
+
+    SECTION("line() returns lines across multiple nodes")
+    {
+        afv::buf::text_buffer buffer;
+        buffer.insert(0, "ab\ncd"sv);
+        buffer.insert(4, "x\ny\n"sv);
+
+        REQUIRE(std::ranges::equal("ab"sv, buffer.line(0)));
+        REQUIRE(std::ranges::equal("cx"sv, buffer.line(1)));
+        REQUIRE(std::ranges::equal("y"sv, buffer.line(2)));
+        REQUIRE(std::ranges::equal("d"sv, buffer.line(3)));
+        REQUIRE(std::ranges::equal(""sv, buffer.line(4)));
+    }
+
+    SECTION("line() returns part of the line displayed in columns")
+    {
+        afv::buf::u8text_buffer buffer;
+        buffer.insert(0, u8"ab\n\u65E5cd\u65E5e"sv);
+
+        REQUIRE(std::ranges::equal(u8"b"sv, buffer.line(0, 1, 2)));
+        REQUIRE(std::ranges::equal(u8"\u65E5c"sv, buffer.line(1, 0, 3)));
+        REQUIRE(std::ranges::equal(u8"cd"sv, buffer.line(1, 2, 4)));
+        REQUIRE(std::ranges::equal(u8"\u65E5e"sv, buffer.line(1, 4, 10)));
+        REQUIRE(std::ranges::equal(u8""sv, buffer.line(1, 10, 20)));
+    }
+}
+
+TEST_CASE("afv::buf::basic_text_buffer line endings")
+{
+    using namespace std::string_view_literals;
+
+    using text_buffer = afv::buf::text_buffer;
+    using afv::buf::line_ending;
+    SECTION("line() excludes CRLF line terminators")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abc\r\ndef\r\n"sv);
+
+        REQUIRE(buffer.lines() == 2);
+        REQUIRE(std::ranges::equal("abc"sv, buffer.line(0)));
+        REQUIRE(std::ranges::equal("def"sv, buffer.line(1)));
+        REQUIRE(std::ranges::equal(""sv, buffer.line(2)));
+        REQUIRE(buffer.line_endings() == line_ending::crlf);
+        REQUIRE(buffer.line_terminator() == "\r\n"sv);
+    }
+
+    SECTION("line() recognizes CR as line separator")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abc\rdef\rghi"sv);
+
+        REQUIRE(buffer.lines() == 3);
+        REQUIRE(std::ranges::equal("abc"sv, buffer.line(0)));
+        REQUIRE(std::ranges::equal("def"sv, buffer.line(1)));
+        REQUIRE(std::ranges::equal("ghi"sv, buffer.line(2)));
+        REQUIRE(buffer.line_endings() == line_ending::cr);
+        REQUIRE(buffer.line_terminator() == "\r"sv);
+    }
+
+    SECTION("line endings of content without line terminators")
+    {
+        text_buffer buffer;
+        REQUIRE(buffer.line_endings() == line_ending::none);
+
+        buffer.insert(0, "abc"sv);
+        REQUIRE(buffer.line_endings() == line_ending::none);
+        REQUIRE(buffer.line_terminator() == "\n"sv);
+    }
+
+    SECTION("line endings of mixed content")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "a\nb\r\nc"sv);
+
+        REQUIRE(buffer.lines() == 3);
+        REQUIRE(std::ranges::equal("b"sv, buffer.line(1)));
+        REQUIRE(buffer.line_endings() == line_ending::mixed);
+        REQUIRE(buffer.line_terminator() == "\n"sv);
+    }
+
+    SECTION("CRLF split between insertions is a single line terminator")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abc\r"sv);
+        REQUIRE(buffer.lines() == 1);
+
+        buffer.insert(4, "\ndef\r"sv);
+        buffer.insert(9, "\n"sv);
+
+        REQUIRE(buffer.lines() == 2);
+        REQUIRE(std::ranges::equal("abc"sv, buffer.line(0)));
+        REQUIRE(std::ranges::equal("def"sv, buffer.line(1)));
+        REQUIRE(buffer.line_endings() == line_ending::crlf);
+        REQUIRE(buffer.position(5) == afv::buf::text_position{1, 0, 0});
+    }
+
+    SECTION("CR becomes part of CRLF when LF is inserted after it")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "a\rx"sv);
+        REQUIRE(buffer.line_endings() == line_ending::cr);
+
+        buffer.insert(2, "\n"sv);
+        REQUIRE(buffer.lines() == 2);
+        REQUIRE(buffer.line_endings() == line_ending::crlf);
+        REQUIRE(buffer.line_terminator() == "\r\n"sv);
+
+        text_buffer typed;
+        typed.insert(0, "a"sv);
+        typed.insert(1, "\r"sv);
+        typed.insert(2, "\n"sv);
+        typed.insert(3, "b"sv);
+        REQUIRE(typed.line_endings() == line_ending::crlf);
+
+        typed.insert(2, "x"sv);
+        REQUIRE(typed.line_endings() == line_ending::mixed);
+    }
+
+    SECTION("insertion between CR and LF separates the line terminator")
+    {
+        text_buffer buffer;
+        buffer.insert(0, "abc\r\ndef"sv);
+        buffer.insert(4, "x"sv);
+
+        REQUIRE(buffer.lines() == 3);
+        REQUIRE(std::ranges::equal("abc"sv, buffer.line(0)));
+        REQUIRE(std::ranges::equal("x"sv, buffer.line(1)));
+        REQUIRE(std::ranges::equal("def"sv, buffer.line(2)));
+        REQUIRE(buffer.line_endings() == line_ending::mixed);
+    }
+
+    SECTION("insert_batch() detects line endings at insertion sites")
+    {
+        using insertions =
+            std::vector<std::pair<std::size_t, std::string_view>>;
+
+        text_buffer buffer;
+        buffer.insert(0, "ab\r"sv);
+        buffer.insert_batch(insertions{{1, "\r\n"sv}, {3, "\ncd"sv}});
+
+        REQUIRE(std::ranges::equal(buffer, "a\r\nb\r\ncd"sv));
+        REQUIRE(buffer.lines() == 3);
+        REQUIRE(std::ranges::equal("b"sv, buffer.line(1)));
+        REQUIRE(buffer.line_endings() == line_ending::crlf);
+    }
+
+    SECTION("line terminators of wide code units")
+    {
+        auto const check = [](auto const content)
+        {
+            using char_type = std::ranges::range_value_t<decltype(content)>;
+
+            afv::buf::basic_text_buffer<char_type> buffer;
+            buffer.insert(0, content);
+
+            REQUIRE(buffer.lines() == 4);
+            REQUIRE(buffer.line_width(0) == 10);
+            REQUIRE(buffer.line_width(1) == 0);
+            REQUIRE(buffer.line_width(2) == 3);
+            REQUIRE(buffer.line_width(3) == 10);
+            REQUIRE(buffer.line_endings() == line_ending::mixed);
+        };
+
+        check(u"0123456789\r\n\rabc\nlast line \r"sv);
+        check(U"0123456789\r\n\rabc\nlast line \r"sv);
+        check(L"0123456789\r\n\rabc\nlast line \r"sv);
+    }
+}
+
+TEST_CASE("afv::buf::basic_text_buffer borrowed content")
+{
+    using namespace std::string_view_literals;
+
+    using text_buffer = afv::buf::text_buffer;
+    SECTION("insert_borrowed() doesn't copy the content")
+    {
+        std::string content{"abc\ndef"};
+        text_buffer buffer;
+        buffer.insert_borrowed(0, content);
+
+        REQUIRE(buffer.lines() == 2);
+        REQUIRE(std::ranges::equal("def"sv, buffer.line(1)));
+
+        *buffer.begin() = 'x';
+        REQUIRE(content == "xbc\ndef");
+    }
+
+    SECTION("insert_borrowed() with offsets only")
+    {
+        std::string content{"ab\ncd\r"};
+        text_buffer buffer;
+        buffer.insert_borrowed(0, content, afv::buf::indexing::offsets);
+        buffer.insert(2, "\n"sv);
+
+        REQUIRE(buffer.size() == 7);
+        REQUIRE(buffer.lines() == 2);
+        REQUIRE(std::ranges::equal("ab"sv, buffer.line(0)));
+        REQUIRE(std::ranges::equal("\ncd\r"sv, buffer.line(1)));
+        REQUIRE(buffer.line_endings() == afv::buf::line_ending::lf);
+    }
+
+    SECTION("for_each_span() visits pieces of the range")
+    {
+        std::string content{"abcdef"};
+        text_buffer buffer;
+        buffer.insert_borrowed(0, content, afv::buf::indexing::offsets);
+        buffer.insert(3, "XY"sv);
+
+        std::vector<std::string> spans;
+        buffer.for_each_span(2,
+            4,
+            [&spans](std::span<char const> span)
+            { spans.emplace_back(span.begin(), span.end()); });
+        REQUIRE(spans == std::vector<std::string>{"c", "XY", "d"});
+
+        spans.clear();
+        buffer.for_each_span(6,
+            100,
+            [&spans](std::span<char const> span)
+            { spans.emplace_back(span.begin(), span.end()); });
+        REQUIRE(spans == std::vector<std::string>{"ef"});
+
+        spans.clear();
+        buffer.for_each_span(100,
+            1,
+            [&spans](std::span<char const> span)
+            { spans.emplace_back(span.begin(), span.end()); });
+        REQUIRE(spans.empty());
+    }
+}
+
+TEST_CASE("afv::buf::basic_text_buffer compressed storage")
+{
+    using text_buffer = afv::buf::text_buffer;
+
+    auto const repeat = [](std::string_view line)
+    {
+        std::string rv;
+        while (rv.size() < 65536)
+        {
+            rv.append(line);
+        }
+        return rv;
+    };
+
+    auto const first{repeat("first line\n")};
+    auto const second{repeat("second line\n")};
+    auto const third{repeat("third line\n")};
+    auto const all{first + second + third};
+
+    text_buffer buffer;
+    buffer.insert(0, first);
+    buffer.insert(buffer.size(), second);
+    buffer.insert(buffer.size(), third);
+    REQUIRE(buffer.resident_size() == all.size());
+
+    buffer.set_resident_limit(third.size());
+    buffer.trim();
+    REQUIRE(buffer.resident_size() == third.size());
+
+    SECTION("trim() keeps the content")
+    {
+        text_buffer const& view{buffer};
+        REQUIRE(std::ranges::equal(view, all));
+        REQUIRE(view.lines() ==
+            static_cast<std::size_t>(std::ranges::count(all, '\n')));
+        REQUIRE(std::ranges::equal(view.line(6000),
+            std::string_view{"second line"}));
+    }
+
+    SECTION("trim() compresses least recently used content first")
+    {
+        text_buffer const& view{buffer};
+        REQUIRE(
+            std::ranges::equal(view.line(0), std::string_view{"first line"}));
+        REQUIRE(buffer.resident_size() == first.size() + third.size());
+
+        buffer.trim();
+        REQUIRE(buffer.resident_size() == first.size());
+    }
+
+    SECTION("trim() keeps modifications made through iterators")
+    {
+        *buffer.begin() = 'F';
+        buffer.trim();
+        REQUIRE(buffer.resident_size() <= third.size());
+
+        text_buffer const& view{buffer};
+        REQUIRE(
+            std::ranges::equal(view.line(0), std::string_view{"First line"}));
+    }
+
+    SECTION("insertion before compressed content doesn't decompress it")
+    {
+        // Terminators span the boundaries of the compressed buffers
+        std::string const cr_last{repeat("line\r\n").append("\r")};
+        std::string const lf_first{"\n" + repeat("line\r\n")};
+
+        text_buffer cold;
+        for (int i{}; i != 10; ++i)
+        {
+            cold.insert(cold.size(), cr_last);
+            cold.insert(cold.size(), lf_first);
+        }
+        auto const lines{cold.lines()};
+
+        cold.set_resident_limit(2 * lf_first.size());
+        cold.trim();
+        auto const resident{cold.resident_size()};
+        REQUIRE(resident <= 2 * lf_first.size());
+
+        cold.insert(0, std::string_view{"x"});
+        REQUIRE(cold.resident_size() == resident + 1);
+
+        cold.insert_batch(std::vector<std::pair<std::size_t, std::string>>{
+            {0, "y"},
+            {1, "z"}});
+        REQUIRE(cold.resident_size() == resident + 3);
+
+        REQUIRE(cold.lines() == lines);
+        REQUIRE(cold.line_endings() == afv::buf::line_ending::crlf);
+        REQUIRE(cold.resident_size() == resident + 3);
+    }
+
+    SECTION("trim() doesn't compress small content")
+    {
+        text_buffer small;
+        small.insert(0, std::string_view{"small"});
+        small.set_resident_limit(0);
+        small.trim();
+        REQUIRE(small.resident_size() == 5);
+    }
+}
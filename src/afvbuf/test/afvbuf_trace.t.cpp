@@ -0,0 +1,109 @@
+#include <afvbuf_trace.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    [[nodiscard]] std::vector<afv::buf::trace_event> events_named(
+        std::string_view const name)
+    {
+        std::vector<afv::buf::trace_event> rv;
+        std::ranges::copy_if(afv::buf::trace_events(),
+            std::back_inserter(rv),
+            [name](afv::buf::trace_event const& event)
+            { return event.name == name; });
+        return rv;
+    }
+} // namespace
+
+TEST_CASE("afv::buf::scoped_timer")
+{
+    SECTION("timer records an event when it goes out of scope")
+    {
+        auto const before{afv::buf::detail::trace_clock()};
+        {
+            afv::buf::scoped_timer const timer{"test::scope"};
+            REQUIRE(events_named("test::scope").empty());
+        }
+        auto const after{afv::buf::detail::trace_clock()};
+
+        auto const events{events_named("test::scope")};
+        REQUIRE(events.size() == 1);
+        REQUIRE(events.front().start >= before);
+        REQUIRE(events.front().start + events.front().duration <= after);
+    }
+
+    SECTION("events are recorded by concurrent threads")
+    {
+        constexpr std::size_t threads{4};
+        constexpr std::size_t events_per_thread{1000};
+        {
+            std::vector<std::jthread> workers;
+            for (std::size_t i{}; i != threads; ++i)
+            {
+                workers.emplace_back(
+                    []()
+                    {
+                        for (std::size_t j{}; j != events_per_thread; ++j)
+                        {
+                            afv::buf::scoped_timer const timer{"test::thread"};
+                        }
+                    });
+            }
+        }
+
+        auto const events{events_named("test::thread")};
+        REQUIRE(events.size() == threads * events_per_thread);
+
+        std::set<std::uint32_t> thread_ids;
+        for (auto const& event : events)
+        {
+            thread_ids.insert(event.thread);
+        }
+        REQUIRE(thread_ids.size() == threads);
+    }
+}
+
+TEST_CASE("afv::buf::write_chrome_trace")
+{
+    std::vector<afv::buf::trace_event> const events{
+        {.name = "frame", .start = 5000, .duration = 2500, .thread = 0},
+        {.name = "buf::\"line\"", .start = 6000, .duration = 7, .thread = 1}};
+
+    std::ostringstream out;
+    afv::buf::write_chrome_trace(out, events);
+
+    REQUIRE(out.str() ==
+        "{\"traceEvents\":[\n"
+        "{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,"
+        "\"ts\":0.000,\"dur\":2.500},\n"
+        "{\"name\":\"buf::\\\"line\\\"\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+        "\"ts\":1.000,\"dur\":0.007}\n"
+        "]}\n");
+}
+
+TEST_CASE("afv::buf::trace_percentile")
+{
+    std::vector<afv::buf::trace_event> events;
+    for (std::uint64_t i{1}; i <= 100; ++i)
+    {
+        events.push_back({.name = "frame", .duration = 101 - i});
+        events.push_back({.name = "other", .duration = 1000});
+    }
+
+    REQUIRE(afv::buf::trace_percentile(events, "frame", 50) == 50);
+    REQUIRE(afv::buf::trace_percentile(events, "frame", 99) == 99);
+    REQUIRE(afv::buf::trace_percentile(events, "frame", 100) == 100);
+    REQUIRE(afv::buf::trace_percentile(events, "frame", 0) == 1);
+    REQUIRE(afv::buf::trace_percentile(events, "missing", 99) == 0);
+}
@@ -0,0 +1,139 @@
+#include <afvbuf_unicode.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+TEST_CASE("afv::buf::decode")
+{
+    using namespace std::string_view_literals;
+
+    SECTION("decode() UTF-8 sequences")
+    {
+        auto const text{u8"a\u00E9\u20AC\U0001F600"sv};
+        std::span<char8_t const> units{text};
+
+        REQUIRE(afv::buf::decode(units).value == U'a');
+        REQUIRE(afv::buf::decode(units.subspan(1)).value == U'\u00E9');
+        REQUIRE(afv::buf::decode(units.subspan(1)).length == 2);
+        REQUIRE(afv::buf::decode(units.subspan(3)).value == U'\u20AC');
+        REQUIRE(afv::buf::decode(units.subspan(3)).length == 3);
+        REQUIRE(afv::buf::decode(units.subspan(6)).value == U'\U0001F600');
+        REQUIRE(afv::buf::decode(units.subspan(6)).length == 4);
+    }
+
+    SECTION("decode() UTF-16 surrogate pair")
+    {
+        auto const text{u"\U0001F600"sv};
+        auto const decoded{afv::buf::decode(std::span{text})};
+
+        REQUIRE(decoded.valid);
+        REQUIRE(decoded.value == U'\U0001F600');
+        REQUIRE(decoded.length == 2);
+    }
+
+    SECTION("decode() invalid sequences as a single code unit")
+    {
+        auto const overlong{"\xC0\x80"sv};
+        auto const truncated{"\xE2\x82"sv};
+        auto const surrogate{"\xED\xA0\x80"sv};
+
+        for (auto const text : {overlong, truncated, surrogate})
+        {
+            auto const decoded{afv::buf::decode(std::span{text})};
+            REQUIRE_FALSE(decoded.valid);
+            REQUIRE(decoded.value == afv::buf::replacement_character);
+            REQUIRE(decoded.length == 1);
+        }
+    }
+}
+
+TEST_CASE("afv::buf::is_valid_encoding")
+{
+    using namespace std::string_view_literals;
+
+    REQUIRE(afv::buf::is_valid_encoding(
+        std::span{"plain ASCII text which is longer than one block"sv}));
+    REQUIRE(afv::buf::is_valid_encoding(
+        std::span{u8"\u010Cak \u0161est \u017Eab, \u65E5\u672C"sv}));
+    REQUIRE_FALSE(afv::buf::is_valid_encoding(
+        std::span{"valid ASCII prefix longer than a block \xFF"sv}));
+    REQUIRE_FALSE(afv::buf::is_valid_encoding(std::span{"\xE2\x82"sv}));
+}
+
+TEST_CASE("afv::buf::count_code_points")
+{
+    using namespace std::string_view_literals;
+
+    REQUIRE(afv::buf::count_code_points(std::span{"abc"sv}) == 3);
+    REQUIRE(afv::buf::count_code_points(
+                std::span{u8"a\u00E9\u20AC\U0001F600"sv}) == 4);
+    REQUIRE(afv::buf::count_code_points(std::span{u"a\U0001F600"sv}) == 2);
+    REQUIRE(afv::buf::count_code_points(std::span{U"a\U0001F600"sv}) == 2);
+}
+
+TEST_CASE("afv::buf::display_width")
+{
+    using namespace std::string_view_literals;
+
+    REQUIRE(afv::buf::display_width(U'a') == 1);
+    REQUIRE(afv::buf::display_width(U'\u0301') == 0);
+    REQUIRE(afv::buf::display_width(U'\u65E5') == 2);
+    REQUIRE(afv::buf::display_width(U'\U0001F600') == 2);
+
+    auto const text{u8"e\u0301\u65E5x"sv};
+    std::span<char8_t const> units{text};
+    REQUIRE(afv::buf::count_columns(units, 0, units.size()) == 4);
+}
+
+TEST_CASE("afv::buf::count_columns")
+{
+    using namespace std::string_view_literals;
+
+    SECTION("count_columns() skips the rest of a valid sequence")
+    {
+        auto const text{u8"é日x"sv};
+        std::span<char8_t const> units{text};
+
+        REQUIRE(afv::buf::count_columns(units, 1, units.size()) == 3);
+        REQUIRE(afv::buf::count_columns(units, 3, units.size()) == 1);
+        REQUIRE(afv::buf::count_columns(units, 4, units.size()) == 1);
+    }
+
+    SECTION("count_columns() counts every code unit which doesn't decode")
+    {
+        // Stray continuation, truncated sequence, invalid lead and a
+        // continuation after an invalid lead
+        auto const text{"a\x81\xE2\x82z\xFF\xC0\x80"sv};
+        std::span<char const> units{text};
+
+        std::size_t decoded_columns{};
+        for (auto rest{units}; !rest.empty();)
+        {
+            auto const decoded{afv::buf::decode(rest)};
+            decoded_columns += afv::buf::display_width(decoded.value);
+            rest = rest.subspan(decoded.length);
+        }
+
+        REQUIRE(decoded_columns == 8);
+        REQUIRE(afv::buf::count_columns(units, 0, units.size()) == 8);
+
+        std::size_t unit_columns{};
+        for (std::size_t i{}; i != units.size(); ++i)
+        {
+            unit_columns += afv::buf::count_columns(units, i, i + 1);
+        }
+        REQUIRE(unit_columns == 8);
+    }
+
+    SECTION("count_columns() counts a stray UTF-16 low surrogate")
+    {
+        std::u16string const text{u'a', char16_t{0xDC00}, u'b'};
+        std::span<char16_t const> units{text};
+
+        REQUIRE(afv::buf::count_columns(units, 0, units.size()) == 3);
+    }
+}